@@ -16,6 +16,6 @@ set_target_properties(engine PROPERTIES
 		LINKER_LANGUAGE CXX
 		FOLDER "lib")
 
-target_link_libraries(engine PRIVATE igl igl_opengl igl_opengl_glfw igl_opengl_glfw_imgui igl_eigen)
+target_link_libraries(engine PRIVATE igl igl_opengl igl_opengl_glfw igl_opengl_glfw_imgui igl_eigen igl_stb_image)
 
 target_include_directories(engine PUBLIC ${CMAKE_SOURCE_DIR}/engine)
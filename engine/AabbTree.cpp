@@ -0,0 +1,403 @@
+#include "AabbTree.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include "ThreadPool.h"
+
+
+namespace cg3d
+{
+
+AabbTree::Proxy& AabbTree::Proxy::operator=(Proxy&& other) noexcept
+{
+    if (this != &other) {
+        Reset();
+        tree = std::move(other.tree);
+        id = other.id;
+        other.id = -1;
+    }
+    return *this;
+}
+
+void AabbTree::Proxy::Reset()
+{
+    if (auto t = tree.lock(); t && id >= 0)
+        t->Remove(id);
+    tree.reset();
+    id = -1;
+}
+
+float AabbTree::Area(const Box& box)
+{
+    Eigen::Vector3f d = box.sizes();
+    return 2 * (d.x() * d.y() + d.y() * d.z() + d.z() * d.x());
+}
+
+AabbTree::Box AabbTree::Fatten(const Box& box) const
+{
+    Eigen::Vector3f margin = Eigen::Vector3f::Constant(fatMargin * box.sizes().maxCoeff() + 1e-4f);
+    return {box.min() - margin, box.max() + margin};
+}
+
+int AabbTree::Hierarchy::Allocate()
+{
+    if (freeNodes.empty()) {
+        nodes.emplace_back();
+        return int(nodes.size() - 1);
+    }
+    int index = freeNodes.back();
+    freeNodes.pop_back();
+    nodes[index] = Node{};
+    return index;
+}
+
+void AabbTree::Hierarchy::Refit(int index)
+{
+    for (; index != -1; index = nodes[index].parent)
+        nodes[index].box = nodes[nodes[index].left].box.merged(nodes[nodes[index].right].box);
+}
+
+int AabbTree::Hierarchy::InsertLeaf(int proxy, const Box& box)
+{
+    int leaf = Allocate();
+    nodes[leaf].box = box;
+    nodes[leaf].proxy = proxy;
+
+    if (root == -1) {
+        root = leaf;
+        return leaf;
+    }
+
+    // descend to the sibling with the lowest surface area heuristic cost
+    int index = root;
+    while (!nodes[index].IsLeaf()) {
+        float area = Area(nodes[index].box);
+        float combinedArea = Area(nodes[index].box.merged(box));
+        float cost = 2 * combinedArea; // cost of creating a new parent for this node and the new leaf
+        float inheritanceCost = 2 * (combinedArea - area); // minimum cost of pushing the leaf further down
+
+        auto childCost = [&](int child) {
+            float mergedArea = Area(nodes[child].box.merged(box));
+            return (nodes[child].IsLeaf() ? mergedArea : mergedArea - Area(nodes[child].box)) + inheritanceCost;
+        };
+        float leftCost = childCost(nodes[index].left), rightCost = childCost(nodes[index].right);
+
+        if (cost < leftCost && cost < rightCost)
+            break;
+        index = leftCost < rightCost ? nodes[index].left : nodes[index].right;
+    }
+
+    // create a new parent for the sibling and the leaf
+    int sibling = index, oldParent = nodes[sibling].parent;
+    int newParent = Allocate();
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].left = sibling;
+    nodes[newParent].right = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+
+    if (oldParent == -1)
+        root = newParent;
+    else if (nodes[oldParent].left == sibling)
+        nodes[oldParent].left = newParent;
+    else
+        nodes[oldParent].right = newParent;
+
+    Refit(newParent);
+    return leaf;
+}
+
+void AabbTree::Hierarchy::RemoveLeaf(int leaf)
+{
+    freeNodes.push_back(leaf);
+    if (leaf == root) {
+        root = -1;
+        return;
+    }
+
+    int parent = nodes[leaf].parent, grandParent = nodes[parent].parent;
+    int sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+    freeNodes.push_back(parent);
+
+    nodes[sibling].parent = grandParent;
+    if (grandParent == -1) {
+        root = sibling;
+    } else {
+        if (nodes[grandParent].left == parent)
+            nodes[grandParent].left = sibling;
+        else
+            nodes[grandParent].right = sibling;
+        Refit(grandParent);
+    }
+}
+
+float AabbTree::Hierarchy::Cost() const
+{
+    if (root == -1) return 0;
+
+    float cost = 0;
+    std::vector<int> stack{root};
+    while (!stack.empty()) {
+        const Node& node = nodes[stack.back()];
+        stack.pop_back();
+        if (!node.IsLeaf()) {
+            cost += Area(node.box);
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+        }
+    }
+
+    return cost;
+}
+
+AabbTree::Hierarchy AabbTree::Hierarchy::Build(std::vector<std::pair<int, Box>> leaves)
+{
+    Hierarchy built;
+    if (!leaves.empty()) {
+        built.nodes.reserve(2 * leaves.size() - 1);
+        built.root = built.BuildRange(leaves, 0, int(leaves.size()), -1);
+    }
+    return built;
+}
+
+int AabbTree::Hierarchy::BuildRange(std::vector<std::pair<int, Box>>& leaves, int begin, int end, int parent) // NOLINT(misc-no-recursion)
+{
+    int index = Allocate();
+    nodes[index].parent = parent;
+
+    if (end - begin == 1) {
+        nodes[index].proxy = leaves[begin].first;
+        nodes[index].box = leaves[begin].second;
+        return index;
+    }
+
+    // split at the median of the centers along the longest axis of the centers bounds
+    Box centers;
+    for (int i = begin; i < end; i++)
+        centers.extend(leaves[i].second.center());
+    int axis;
+    centers.sizes().maxCoeff(&axis);
+    int middle = (begin + end) / 2;
+    std::nth_element(leaves.begin() + begin, leaves.begin() + middle, leaves.begin() + end,
+                     [axis](const auto& a, const auto& b) { return a.second.center()(axis) < b.second.center()(axis); });
+
+    int left = BuildRange(leaves, begin, middle, index);
+    int right = BuildRange(leaves, middle, end, index);
+    nodes[index].left = left; // note: no references into nodes are kept while building the children (they may reallocate)
+    nodes[index].right = right;
+    nodes[index].box = nodes[left].box.merged(nodes[right].box);
+
+    return index;
+}
+
+int AabbTree::Insert(const Box& box, void* userData)
+{
+    int id;
+    if (freeProxies.empty()) {
+        id = int(proxies.size());
+        proxies.emplace_back();
+    } else {
+        id = freeProxies.back();
+        freeProxies.pop_back();
+    }
+
+    auto& proxy = proxies[id];
+    proxy.box = box;
+    proxy.fatBox = Fatten(box);
+    proxy.userData = userData;
+    proxy.generation = ++generationCounter;
+    proxy.alive = true;
+    proxy.node = hierarchy.InsertLeaf(id, proxy.fatBox);
+    changesSinceCostCheck++;
+
+    return id;
+}
+
+void AabbTree::Remove(int id)
+{
+    auto& proxy = proxies[id];
+    hierarchy.RemoveLeaf(proxy.node);
+    proxy = ProxyData{};
+    freeProxies.push_back(id);
+    changesSinceCostCheck++;
+}
+
+void AabbTree::Move(int id, const Box& box)
+{
+    auto& proxy = proxies[id];
+    proxy.box = box;
+    if (proxy.fatBox.contains(box)) return; // the tree doesn't change as long as the box stays inside the fat box
+
+    hierarchy.RemoveLeaf(proxy.node);
+    proxy.fatBox = Fatten(box);
+    proxy.generation = ++generationCounter;
+    proxy.node = hierarchy.InsertLeaf(id, proxy.fatBox);
+    changesSinceCostCheck++;
+}
+
+void AabbTree::Update()
+{
+    if (pendingBuild.valid()) {
+        if (pendingBuild.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+            ApplyRebuild(pendingBuild.get());
+        return;
+    }
+
+    if (changesSinceCostCheck < changesPerCostCheck) return;
+    changesSinceCostCheck = 0;
+
+    if (GetProxyCount() > 2 && (builtCost < 0 || hierarchy.Cost() > rebuildThreshold * builtCost))
+        StartRebuild();
+}
+
+void AabbTree::StartRebuild()
+{
+    std::vector<std::pair<int, Box>> leaves;
+    leaves.reserve(GetProxyCount());
+    pendingGenerations.resize(proxies.size());
+    for (int id = 0; id < int(proxies.size()); id++) {
+        if (proxies[id].alive)
+            leaves.emplace_back(id, proxies[id].fatBox);
+        pendingGenerations[id] = proxies[id].generation;
+    }
+
+    pendingBuild = ThreadPool::Global().Submit([leaves = std::move(leaves)]() mutable { return Hierarchy::Build(std::move(leaves)); });
+}
+
+void AabbTree::ApplyRebuild(Hierarchy built)
+{
+    // find the leaf of each proxy that was in the snapshot
+    std::vector<int> leafOfProxy(proxies.size(), -1);
+    for (int i = 0; i < int(built.nodes.size()); i++)
+        if (built.nodes[i].IsLeaf() && built.nodes[i].proxy >= 0)
+            leafOfProxy[built.nodes[i].proxy] = i;
+
+    // bring the new hierarchy up to date with the changes made while it was being built
+    for (int id = 0; id < int(proxies.size()); id++) {
+        auto& proxy = proxies[id];
+        int leaf = leafOfProxy[id];
+        bool unchanged = leaf != -1 && id < int(pendingGenerations.size()) && pendingGenerations[id] == proxy.generation;
+        if (proxy.alive && unchanged) {
+            proxy.node = leaf;
+            continue;
+        }
+        if (leaf != -1)
+            built.RemoveLeaf(leaf);
+        if (proxy.alive)
+            proxy.node = built.InsertLeaf(id, proxy.fatBox);
+    }
+
+    hierarchy = std::move(built);
+    builtCost = hierarchy.Cost();
+    changesSinceCostCheck = 0;
+}
+
+void AabbTree::Rebuild()
+{
+    if (pendingBuild.valid())
+        pendingBuild.wait();
+    else
+        StartRebuild();
+    ApplyRebuild(pendingBuild.get());
+}
+
+template<typename Overlaps>
+void AabbTree::Traverse(const Overlaps& overlaps, const Callback& callback) const
+{
+    if (hierarchy.root == -1) return;
+
+    std::vector<int> stack;
+    stack.reserve(64);
+    stack.push_back(hierarchy.root);
+    while (!stack.empty()) {
+        const Node& node = hierarchy.nodes[stack.back()];
+        stack.pop_back();
+        if (node.IsLeaf()) {
+            const auto& proxy = proxies[node.proxy];
+            if (overlaps(proxy.box) && !callback(proxy.userData)) // test the exact (not fat) box of the leaves
+                return;
+        } else if (overlaps(node.box)) {
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+        }
+    }
+}
+
+void AabbTree::QueryBox(const Box& box, const Callback& callback) const
+{
+    Traverse([&box](const Box& nodeBox) { return nodeBox.intersects(box); }, callback);
+}
+
+void AabbTree::QueryFrustum(const Eigen::Matrix4f& viewProj, const Callback& callback) const
+{
+    // extract the 6 planes (a point p is inside when n.p + d >= 0 for all of them)
+    Eigen::Vector4f planes[6];
+    for (int i = 0; i < 3; i++) {
+        planes[2 * i] = viewProj.row(3) + viewProj.row(i);
+        planes[2 * i + 1] = viewProj.row(3) - viewProj.row(i);
+    }
+
+    Traverse([&planes](const Box& nodeBox) {
+        for (const auto& plane: planes) {
+            // test the corner of the box furthest along the plane normal
+            Eigen::Vector3f corner = (plane.head<3>().array() >= 0).select(nodeBox.max(), nodeBox.min());
+            if (plane.head<3>().dot(corner) + plane.w() < 0)
+                return false;
+        }
+        return true;
+    }, callback);
+}
+
+void AabbTree::QueryRay(const Eigen::Vector3f& origin, const Eigen::Vector3f& direction, float maxDistance,
+                        const std::function<bool(void*, float)>& callback) const
+{
+    Eigen::Vector3f inverseDirection = direction.cwiseInverse();
+    float distance = 0;
+
+    auto hit = [&](const Box& box) {
+        Eigen::Vector3f t1 = (box.min() - origin).cwiseProduct(inverseDirection);
+        Eigen::Vector3f t2 = (box.max() - origin).cwiseProduct(inverseDirection);
+        float tNear = std::max(t1.cwiseMin(t2).maxCoeff(), 0.0f);
+        float tFar = std::min(t1.cwiseMax(t2).minCoeff(), maxDistance);
+        distance = tNear;
+        return tNear <= tFar;
+    };
+
+    Traverse(hit, [&](void* userData) { return callback(userData, distance); });
+}
+
+void* AabbTree::QueryNearest(const Eigen::Vector3f& point, float maxDistance, float* distance) const
+{
+    void* nearest = nullptr;
+    float bestSquared = maxDistance * maxDistance;
+
+    // best first search ordered by the distance from the point to the node boxes
+    using Entry = std::pair<float, int>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<>> queue;
+    if (hierarchy.root != -1)
+        queue.emplace(hierarchy.nodes[hierarchy.root].box.squaredExteriorDistance(point), hierarchy.root);
+
+    while (!queue.empty() && queue.top().first < bestSquared) {
+        const Node& node = hierarchy.nodes[queue.top().second];
+        queue.pop();
+        if (node.IsLeaf()) {
+            const auto& proxy = proxies[node.proxy];
+            if (float squared = proxy.box.squaredExteriorDistance(point); squared < bestSquared) {
+                bestSquared = squared;
+                nearest = proxy.userData;
+            }
+        } else {
+            queue.emplace(hierarchy.nodes[node.left].box.squaredExteriorDistance(point), node.left);
+            queue.emplace(hierarchy.nodes[node.right].box.squaredExteriorDistance(point), node.right);
+        }
+    }
+
+    if (distance)
+        *distance = std::sqrt(bestSquared);
+    return nearest;
+}
+
+} // namespace cg3d
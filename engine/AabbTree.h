@@ -0,0 +1,111 @@
+#pragma once
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <functional>
+#include <future>
+#include <memory>
+#include <utility>
+#include <vector>
+
+
+namespace cg3d
+{
+
+// dynamic bounding volume hierarchy over axis aligned boxes (used by Scene as a spatial index of the model bounds)
+// the leaves hold enlarged ("fat") boxes so small movements don't touch the tree at all, and since incremental
+// inserts and removals slowly degrade the tree it is rebuilt in the background when its cost grows too much
+class AabbTree
+{
+public:
+    using Box = Eigen::AlignedBox3f;
+    using Callback = std::function<bool(void* userData)>; // return false to stop the query
+
+    // membership of an object in a tree: removes the object from the tree when destroyed (copies are empty)
+    struct Proxy
+    {
+        std::weak_ptr<AabbTree> tree;
+        int id = -1;
+
+        Proxy() = default;
+        Proxy(std::weak_ptr<AabbTree> tree, int id) : tree(std::move(tree)), id(id) {}
+        Proxy(const Proxy&) : Proxy() {}
+        Proxy(Proxy&& other) noexcept : tree(std::move(other.tree)), id(other.id) { other.id = -1; }
+        Proxy& operator=(const Proxy&) { Reset(); return *this; }
+        Proxy& operator=(Proxy&& other) noexcept;
+        ~Proxy() { Reset(); }
+        void Reset();
+    };
+
+    int Insert(const Box& box, void* userData); // returns the proxy id
+    void Remove(int id);
+    void Move(int id, const Box& box);
+    [[nodiscard]] inline const Box& GetBox(int id) const { return proxies[id].box; }
+    [[nodiscard]] inline void* GetUserData(int id) const { return proxies[id].userData; }
+
+    void Update(); // call once per frame: starts a background rebuild when needed, or applies a finished one
+    void Rebuild(); // synchronous rebuild
+
+    void QueryBox(const Box& box, const Callback& callback) const;
+    void QueryFrustum(const Eigen::Matrix4f& viewProj, const Callback& callback) const; // the frustum of the given (OpenGL) matrix
+    void QueryRay(const Eigen::Vector3f& origin, const Eigen::Vector3f& direction, float maxDistance,
+                  const std::function<bool(void* userData, float distance)>& callback) const; // distance to the box along the ray
+    void* QueryNearest(const Eigen::Vector3f& point, float maxDistance, float* distance = nullptr) const;
+
+    [[nodiscard]] float GetCost() const { return hierarchy.Cost(); } // total surface area of the internal nodes
+    [[nodiscard]] inline int GetProxyCount() const { return int(proxies.size() - freeProxies.size()); }
+
+    float fatMargin = 0.1f; // relative to the box size
+    float rebuildThreshold = 1.5f; // rebuild when the cost grows by this factor since the last rebuild
+    int changesPerCostCheck = 32;
+
+private:
+    struct Node
+    {
+        Box box;
+        int parent = -1, left = -1, right = -1;
+        int proxy = -1; // the proxy of a leaf node (-1 for internal nodes)
+        [[nodiscard]] inline bool IsLeaf() const { return left == -1; }
+    };
+
+    struct Hierarchy
+    {
+        std::vector<Node> nodes;
+        std::vector<int> freeNodes;
+        int root = -1;
+
+        int Allocate();
+        int InsertLeaf(int proxy, const Box& box);
+        void RemoveLeaf(int leaf);
+        void Refit(int index);
+        [[nodiscard]] float Cost() const;
+        static Hierarchy Build(std::vector<std::pair<int, Box>> leaves);
+        int BuildRange(std::vector<std::pair<int, Box>>& leaves, int begin, int end, int parent);
+    };
+
+    struct ProxyData
+    {
+        Box box, fatBox;
+        void* userData = nullptr;
+        int node = -1;
+        unsigned int generation = 0; // changes whenever the fat box changes (for the background rebuild)
+        bool alive = false;
+    };
+
+    static float Area(const Box& box);
+    [[nodiscard]] Box Fatten(const Box& box) const;
+    void StartRebuild();
+    void ApplyRebuild(Hierarchy built);
+    template<typename Overlaps> void Traverse(const Overlaps& overlaps, const Callback& callback) const;
+
+    Hierarchy hierarchy;
+    std::vector<ProxyData> proxies;
+    std::vector<int> freeProxies;
+    unsigned int generationCounter = 0;
+    int changesSinceCostCheck = 0;
+    float builtCost = -1; // cost of the hierarchy right after the last rebuild (negative before the first one)
+    std::future<Hierarchy> pendingBuild;
+    std::vector<unsigned int> pendingGenerations; // the proxy generations at the time the pending build started
+};
+
+} // namespace cg3d
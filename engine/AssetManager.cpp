@@ -0,0 +1,178 @@
+#include "AssetManager.h"
+
+#include <filesystem>
+#include "Mesh.h"
+#include "Model.h"
+#include "MeshReader.h"
+#include "Texture.h"
+#include "Program.h"
+
+namespace fs = std::filesystem;
+
+
+namespace cg3d
+{
+
+namespace
+{
+
+std::string CanonicalPath(const std::string& file)
+{
+    std::error_code error;
+    auto path = fs::weakly_canonical(file, error);
+    return error ? file : path.string();
+}
+
+std::size_t MeshBytes(const Mesh& mesh)
+{
+    std::size_t bytes = 0;
+    for (const auto& data: mesh.data)
+        bytes += (data.GetVertices().size() + data.GetVertexNormals().size() + data.GetTextureCoords().size()) * sizeof(float) + data.GetFaces().size() * sizeof(int);
+    return bytes;
+}
+
+} // namespace
+
+AssetManager& AssetManager::Global()
+{
+    static AssetManager assetManager;
+    return assetManager;
+}
+
+template<typename T>
+std::vector<std::shared_ptr<T>> AssetManager::Lock(const std::vector<std::weak_ptr<T>>& weakAssets)
+{
+    std::vector<std::shared_ptr<T>> assets;
+    for (const auto& weakAsset: weakAssets) {
+        assets.push_back(weakAsset.lock());
+        if (!assets.back()) return {};
+    }
+    return assets;
+}
+
+template<typename T, typename Load, typename Bytes>
+std::vector<std::shared_ptr<T>> AssetManager::Get(std::unordered_map<std::string, std::vector<std::weak_ptr<T>>>& cache, const std::string& key,
+                                                  const Load& load, const Bytes& bytes)
+{
+    auto retain = [this, &key, &bytes](const std::vector<std::shared_ptr<T>>& assets) {
+        std::size_t totalBytes = 0;
+        for (const auto& asset: assets)
+            totalBytes += bytes(*asset);
+        Retain(key, std::make_shared<const std::vector<std::shared_ptr<T>>>(assets), totalBytes);
+    };
+
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        auto it = cache.find(key);
+        if (it != cache.end()) {
+            auto assets = Lock(it->second);
+            if (!assets.empty()) {
+                retain(assets);
+                return assets;
+            }
+        }
+    }
+
+    // load without the mutex locked, so other assets can be requested meanwhile
+    std::vector<std::shared_ptr<T>> loaded = load();
+    std::lock_guard<std::mutex> guard(mutex);
+    auto& entry = cache[key];
+    auto assets = Lock(entry);
+    if (assets.empty()) { // (otherwise another thread loaded the same asset meanwhile)
+        assets = std::move(loaded);
+        entry.assign(assets.begin(), assets.end());
+    }
+    retain(assets);
+    return assets;
+}
+
+std::vector<std::shared_ptr<Mesh>> AssetManager::GetMeshes(const std::string& file, bool perObject)
+{
+    auto path = CanonicalPath(file);
+    return Get<Mesh>(meshes, (perObject ? "meshes|" : "mesh|") + path, [&]() {
+        auto dataList = MeshReader::MeshDataListFromFile(file);
+        std::string name = fs::path(file).stem().string();
+        std::vector<std::shared_ptr<Mesh>> meshList;
+        if (!perObject) {
+            meshList.push_back(std::make_shared<Mesh>(std::move(name), std::move(dataList)));
+        } else {
+            for (int i = 0; i < int(dataList.size()); i++)
+                meshList.push_back(std::make_shared<Mesh>(name + "_mesh" + (dataList.size() > 1 ? std::to_string(i + 1) : ""), std::vector<MeshData>{std::move(dataList[i])}));
+        }
+        return meshList;
+    }, MeshBytes);
+}
+
+std::shared_ptr<Mesh> AssetManager::GetMesh(const std::string& file)
+{
+    return GetMeshes(file, false)[0];
+}
+
+std::vector<std::shared_ptr<Mesh>> AssetManager::GetMeshList(const std::string& file)
+{
+    return GetMeshes(file, true);
+}
+
+std::shared_ptr<Texture> AssetManager::GetTexture(const std::string& file, int dim)
+{
+    return Get<Texture>(textures, "texture|" + std::to_string(dim) + "|" + CanonicalPath(file), [&]() {
+        return std::vector<std::shared_ptr<Texture>>{std::make_shared<Texture>(file, dim)};
+    }, [](const Texture& texture) { return texture.GetByteSize(); })[0];
+}
+
+std::shared_ptr<Program> AssetManager::GetProgram(const std::string& fileNameWithoutExtension, bool overlay)
+{
+    return Get<Program>(programs, "program|" + std::to_string(int(overlay)) + "|" + CanonicalPath(fileNameWithoutExtension), [&]() {
+        return std::vector<std::shared_ptr<Program>>{std::make_shared<Program>(fileNameWithoutExtension, overlay)};
+    }, [](const Program&) { return std::size_t(0); })[0];
+}
+
+std::shared_ptr<Model> AssetManager::CreateModel(std::string name, const std::string& file, std::shared_ptr<Material> material)
+{
+    return Model::Create(std::move(name), GetMeshList(file), std::move(material));
+}
+
+void AssetManager::SetMemoryBudget(std::size_t bytes)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    memoryBudget = bytes;
+    Evict(memoryBudget);
+}
+
+std::size_t AssetManager::GetRetainedBytes() const
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    return retainedBytes;
+}
+
+void AssetManager::ReleaseRetained()
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    Evict(0);
+}
+
+void AssetManager::Retain(const std::string& key, std::shared_ptr<const void> asset, std::size_t bytes)
+{
+    if (memoryBudget == 0) return;
+
+    auto it = retainedByKey.find(key);
+    if (it != retainedByKey.end()) {
+        retainedBytes -= it->second->bytes;
+        retained.erase(it->second);
+    }
+    retained.push_front({key, std::move(asset), bytes});
+    retainedByKey[key] = retained.begin();
+    retainedBytes += bytes;
+    Evict(memoryBudget);
+}
+
+void AssetManager::Evict(std::size_t budget)
+{
+    while (!retained.empty() && (retainedBytes > budget || budget == 0)) {
+        retainedBytes -= retained.back().bytes;
+        retainedByKey.erase(retained.back().key);
+        retained.pop_back();
+    }
+}
+
+} // namespace cg3d
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace cg3d
+{
+
+class Mesh;
+class Model;
+class Material;
+class Texture;
+class Program;
+
+/**
+    Registry of the assets loaded from files (meshes, textures and programs), keyed on the canonical path of the file
+    and the load options, so everyone loading the same asset shares one object. The registry doesn't own the assets:
+    an asset is released when its last user releases it, unless a memory budget is set, in which case the most recently
+    requested assets are also kept alive up to the budget (so they can be reloaded for free).
+    The meshes are shared too, so copy a mesh before editing it unless the change is meant for all its users.
+**/
+class AssetManager
+{
+public:
+    static AssetManager& Global();
+
+    // (the mesh files are read with MeshReader::MeshDataListFromFile, so any of its formats)
+    std::shared_ptr<Mesh> GetMesh(const std::string& file); // the meshes of a file as the data list of one mesh (see ObjLoader::MeshFromObj)
+    std::vector<std::shared_ptr<Mesh>> GetMeshList(const std::string& file); // a mesh per object of a file (see ObjLoader::ModelFromObj)
+    std::shared_ptr<Texture> GetTexture(const std::string& file, int dim); // (see Texture::Texture, needs the GL context)
+    std::shared_ptr<Program> GetProgram(const std::string& fileNameWithoutExtension, bool overlay = false); // (see Program::Program)
+
+    // a model showing the shared meshes of a file (like ObjLoader::ModelFromObj, without reloading the file)
+    std::shared_ptr<Model> CreateModel(std::string name, const std::string& file, std::shared_ptr<Material> material);
+
+    // bytes of recently requested assets to keep alive when they aren't used (0, the default, releases them at once)
+    void SetMemoryBudget(std::size_t bytes);
+    [[nodiscard]] std::size_t GetRetainedBytes() const;
+    void ReleaseRetained(); // (call before the GL context is destroyed if there's a budget)
+
+private:
+    struct Retained
+    {
+        std::string key;
+        std::shared_ptr<const void> asset;
+        std::size_t bytes;
+    };
+
+    template<typename T>
+    static std::vector<std::shared_ptr<T>> Lock(const std::vector<std::weak_ptr<T>>& weakAssets); // (empty if any expired)
+    // the assets of a key, loaded with load() if they aren't alive (bytes(asset) estimates the memory of an asset)
+    template<typename T, typename Load, typename Bytes>
+    std::vector<std::shared_ptr<T>> Get(std::unordered_map<std::string, std::vector<std::weak_ptr<T>>>& cache, const std::string& key, const Load& load, const Bytes& bytes);
+    std::vector<std::shared_ptr<Mesh>> GetMeshes(const std::string& file, bool perObject);
+    void Retain(const std::string& key, std::shared_ptr<const void> asset, std::size_t bytes); // (with the mutex locked)
+    void Evict(std::size_t budget); // (with the mutex locked)
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, std::vector<std::weak_ptr<Mesh>>> meshes;
+    std::unordered_map<std::string, std::vector<std::weak_ptr<Texture>>> textures;
+    std::unordered_map<std::string, std::vector<std::weak_ptr<Program>>> programs;
+    std::list<Retained> retained; // most recently requested first
+    std::unordered_map<std::string, std::list<Retained>::iterator> retainedByKey;
+    std::size_t memoryBudget = 0, retainedBytes = 0;
+};
+
+} // namespace cg3d
@@ -8,6 +8,7 @@
 
 #include <get_seconds.h>
 #include "Renderer.h"
+#include "FrameCapture.h"
 #include "Debug.h"
 #include "DebugHacks.h"
 
@@ -124,6 +125,11 @@ void Display::LaunchRendering(bool loop) const
         double tic = igl::get_seconds();
 
         renderer->Draw();
+        if (renderer->frameCapture) {
+            int frameWidth, frameHeight;
+            glfwGetFramebufferSize(window, &frameWidth, &frameHeight);
+            renderer->frameCapture->Capture(frameWidth, frameHeight);
+        }
         SwapBuffers();
         glfwPollEvents();
 
@@ -149,6 +155,10 @@ void Display::LaunchRendering(bool loop) const
         }
 #endif
     }
+
+    // write the frames still in flight while the context is alive
+    if (renderer->frameCapture && glfwWindowShouldClose(window))
+        renderer->frameCapture->Stop();
 }
 
 void Display::SwapBuffers() const
@@ -42,7 +42,9 @@ void DrawVisitor::Visit(Scene* scene)
 void DrawVisitor::Visit(Model* model)
 {
     if (!model->isHidden) {
-        Eigen::Matrix4f modelTransform = model->isStatic ? model->aggregatedTransform : norm * model->aggregatedTransform;
+        Eigen::Matrix4f modelTransform = ModelTransform(model);
+        MeshClusters::View clusterView(proj, view * modelTransform, model->cullBackClusters);
+        const MeshClusters::View* cullingView = model->cullClusters ? &clusterView : nullptr;
         const Program* program = model->material->BindProgram();
         scene->Update(*program, proj, view, modelTransform);
         glLineWidth(model->lineWidth);
@@ -51,13 +53,13 @@ void DrawVisitor::Visit(Model* model)
         glStencilMask(drawOutline && scene->pickedModel && model == scene->pickedModel.get() ? 0xFF : 0x0);
 
         model->material->BindProgram(); // call BindProgram() again to rebind the textures because igl bind_mesh messes them up
-        model->UpdateDataAndDrawMeshes(*program, model->showFaces, model->showTextures);
+        model->UpdateDataAndDrawMeshes(*program, model->showFaces, model->showTextures, cullingView);
 
         if (model->showWireframe) {
             program = model->material->BindFixedColorProgram();
             scene->Update(*program, proj, view, modelTransform);
             program->SetUniform4fv("fixedColor", 1, &model->wireframeColor);
-            model->UpdateDataAndDrawMeshes(*program, false, false);
+            model->UpdateDataAndDrawMeshes(*program, false, false, cullingView);
         }
     }
 
@@ -68,7 +70,7 @@ void DrawVisitor::DrawOutline()
 {
     auto& model = scene->pickedModel;
     auto program = model->material->BindFixedColorProgram();
-    scene->Update(*program, proj, view, model->isStatic ? model->aggregatedTransform : norm * model->aggregatedTransform);
+    scene->Update(*program, proj, view, ModelTransform(model.get()));
     program->SetUniform4fv("fixedColor", 1, &outlineLineColor);
 
     // draw the picked model with thick lines only where previously the stencil wasn't touched (i.e. around the original model)
@@ -0,0 +1,229 @@
+#include "FrameCapture.h"
+
+#include <GL.h>
+#include "Debug.h"
+#include "GLFW/glfw3.h"
+#include <igl_stb_image.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+
+namespace cg3d
+{
+
+FrameCapture::FrameCapture(int encoderThreadCount, int maxQueuedFrames) : maxQueuedFrames(std::max(maxQueuedFrames, 1))
+{
+    if (encoderThreadCount <= 0)
+        encoderThreadCount = std::max(int(std::thread::hardware_concurrency()) / 2, 1);
+    for (int i = 0; i < encoderThreadCount; i++)
+        encoders.emplace_back(&FrameCapture::EncodeFrames, this);
+}
+
+FrameCapture::~FrameCapture()
+{
+    if (glfwGetCurrentContext()) {
+        Stop();
+        for (auto& readback: ring) {
+            if (readback.fence) glDeleteSync(static_cast<GLsync>(readback.fence));
+            if (readback.pbo) glDeleteBuffers(1, &readback.pbo);
+        }
+    }
+
+    {
+        std::lock_guard lock(mutex);
+        stopping = true; // (the encoders write what is left in the queue before they exit)
+    }
+    frameQueued.notify_all();
+    for (auto& encoder: encoders)
+        encoder.join();
+}
+
+void FrameCapture::Start(std::string pathPrefix, Format newFormat)
+{
+    if (capturing) Stop();
+
+    auto directory = std::filesystem::path(pathPrefix).parent_path();
+    std::error_code error;
+    if (!directory.empty()) std::filesystem::create_directories(directory, error);
+    if (error) debug("can't create the capture directory ", directory.string(), ": ", error.message());
+
+    prefix = std::move(pathPrefix);
+    format = newFormat;
+    nextFrameNumber = 0;
+    capturedFrames = droppedFrames = writtenFrames = 0;
+    capturing = true;
+}
+
+void FrameCapture::Stop()
+{
+    capturing = false;
+    Poll(true);
+    Flush();
+}
+
+void FrameCapture::Capture(int width, int height)
+{
+    if (!capturing || width <= 0 || height <= 0) return;
+
+    Poll(false);
+
+    char number[16];
+    std::snprintf(number, sizeof(number), "%06d", nextFrameNumber++);
+
+    // the GPU is still busy with the readback issued RING_SIZE frames ago
+    auto& readback = ring[nextSlot];
+    if (readback.fence) {
+        if (!blockWhenBusy) {
+            droppedFrames++;
+            return;
+        }
+        Retrieve(readback, true);
+    }
+
+    GLint previousReadFrameBuffer = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousReadFrameBuffer);
+
+    size_t size = size_t(width) * size_t(height) * 4;
+    if (!readback.pbo) glGenBuffers(1, &readback.pbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+    if (readback.size != size) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, GLsizeiptr(size), nullptr, GL_STREAM_READ);
+        readback.size = size;
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glReadBuffer(GL_BACK);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr); // (RGBA rows are always 4 byte aligned)
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, previousReadFrameBuffer);
+
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readback.width = width;
+    readback.height = height;
+    readback.file = prefix + number + (format == Format::PNG ? ".png" : ".rgba");
+    nextSlot = (nextSlot + 1) % RING_SIZE;
+    capturedFrames++;
+}
+
+void FrameCapture::Poll(bool wait)
+{
+    for (int i = 0; i < RING_SIZE; i++) {
+        auto& readback = ring[(nextSlot + i) % RING_SIZE];
+        if (readback.fence) Retrieve(readback, wait);
+    }
+}
+
+void FrameCapture::Retrieve(Readback& readback, bool wait)
+{
+    auto fence = static_cast<GLsync>(readback.fence);
+    GLenum status = glClientWaitSync(fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, 0);
+    while (wait && status == GL_TIMEOUT_EXPIRED)
+        status = glClientWaitSync(fence, 0, 1000000000); // (1 second, in nanoseconds)
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED && status != GL_WAIT_FAILED) return;
+    glDeleteSync(fence);
+    readback.fence = nullptr;
+    if (status == GL_WAIT_FAILED) {
+        debug("frame capture fence wait failed, dropping ", readback.file);
+        droppedFrames++;
+        return;
+    }
+
+    Frame frame{{}, readback.width, readback.height, std::move(readback.file), format, keepAlpha};
+    {
+        std::lock_guard lock(mutex);
+        if (!freeBuffers.empty()) {
+            frame.pixels = std::move(freeBuffers.back());
+            freeBuffers.pop_back();
+        }
+    }
+    frame.pixels.resize(readback.size);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+    if (auto data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(readback.size), GL_MAP_READ_BIT)) {
+        std::memcpy(frame.pixels.data(), data, readback.size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        Enqueue(std::move(frame));
+    } else {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        debug("can't map the frame capture buffer, dropping ", frame.file);
+        droppedFrames++;
+    }
+}
+
+void FrameCapture::Enqueue(Frame&& frame)
+{
+    std::unique_lock lock(mutex);
+    if (queue.size() >= maxQueuedFrames) {
+        if (!blockWhenBusy) {
+            freeBuffers.emplace_back(std::move(frame.pixels));
+            droppedFrames++;
+            return;
+        }
+        frameTaken.wait(lock, [&] { return queue.size() < maxQueuedFrames; });
+    }
+    queue.emplace_back(std::move(frame));
+    lock.unlock();
+    frameQueued.notify_one();
+}
+
+void FrameCapture::Flush()
+{
+    std::unique_lock lock(mutex);
+    frameTaken.wait(lock, [&] { return queue.empty() && busyEncoders == 0; });
+}
+
+void FrameCapture::EncodeFrames()
+{
+    std::unique_lock lock(mutex);
+    while (true) {
+        frameQueued.wait(lock, [&] { return stopping || !queue.empty(); });
+        if (queue.empty()) return; // stopping
+
+        Frame frame = std::move(queue.front());
+        queue.pop_front();
+        busyEncoders++;
+        lock.unlock();
+        frameTaken.notify_all();
+
+        if (Write(frame))
+            writtenFrames++;
+        else
+            debug("can't write the captured frame ", frame.file);
+
+        lock.lock();
+        busyEncoders--;
+        freeBuffers.emplace_back(std::move(frame.pixels));
+        frameTaken.notify_all();
+    }
+}
+
+bool FrameCapture::Write(Frame& frame)
+{
+    if (frame.format == Format::RAW) {
+        FILE* file = std::fopen(frame.file.c_str(), "wb");
+        if (!file) return false;
+        bool written = std::fwrite(frame.pixels.data(), 1, frame.pixels.size(), file) == frame.pixels.size();
+        return std::fclose(file) == 0 && written;
+    }
+
+    int components = 4;
+    if (!frame.keepAlpha) { // pack the pixels to RGB in place
+        components = 3;
+        size_t pixelCount = size_t(frame.width) * size_t(frame.height);
+        unsigned char* pixels = frame.pixels.data();
+        for (size_t i = 1; i < pixelCount; i++) {
+            pixels[3 * i] = pixels[4 * i];
+            pixels[3 * i + 1] = pixels[4 * i + 1];
+            pixels[3 * i + 2] = pixels[4 * i + 2];
+        }
+    }
+
+    // GL rows go upwards, so start from the last row with a negative stride instead of flipping the image
+    int stride = frame.width * components;
+    const unsigned char* lastRow = frame.pixels.data() + size_t(frame.height - 1) * size_t(stride);
+    return igl::stbi_write_png(frame.file.c_str(), frame.width, frame.height, components, lastRow, -stride) != 0;
+}
+
+} // namespace cg3d
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace cg3d
+{
+
+/**
+    Captures the frames drawn into the window to numbered image files without stalling the render loop (unlike a plain
+    glReadPixels or igl::png::render_to_png). The frame is read back asynchronously into a ring of pixel buffer objects,
+    copied out a frame or two later when its fence signals, and handed to a pool of encoder threads writing the files.
+    The encoder queue is bounded: when the GPU or the encoders fall behind, Capture either waits for them (so no frame is
+    lost, at the cost of the frame rate) or drops the frame (see blockWhenBusy).
+**/
+class FrameCapture
+{
+public:
+    enum class Format
+    {
+        PNG, // RGB (or RGBA, see keepAlpha) PNG files
+        RAW // the RGBA bytes as read back, bottom row first, no header (e.g. ffmpeg -f rawvideo -pix_fmt rgba -vf vflip)
+    };
+
+    explicit FrameCapture(int encoderThreadCount = 0, int maxQueuedFrames = 8); // 0 threads: half the hardware threads
+    ~FrameCapture(); // finishes writing the captured frames (the ones still on the GPU are lost without a current context)
+
+    FrameCapture(const FrameCapture&) = delete;
+    void operator=(const FrameCapture&) = delete;
+
+    /**
+        @brief Start capturing, numbering the frames from 0 (the frames dropped while capturing leave gaps in the numbers)
+        @param pathPrefix - the files are named by the prefix, the 6 digit frame number and the extension of the format,
+                            e.g. "capture/turntable_" gives capture/turntable_000000.png (the directory is created)
+        @param format     - the format of the files
+    **/
+    void Start(std::string pathPrefix, Format format = Format::PNG);
+    void Stop(); // stop capturing and wait until the frames captured so far are written (call with the GL context current)
+    [[nodiscard]] inline bool IsCapturing() const { return capturing; }
+
+    // read back the frame drawn into the back buffer of the default frame buffer (call after drawing, before swapping)
+    void Capture(int width, int height);
+
+    bool blockWhenBusy = true; // wait for the GPU and the encoders when they fall behind (otherwise drop the frame)
+    bool keepAlpha = false; // write RGBA PNG files (the alpha of the window is often meaningless)
+
+    [[nodiscard]] inline int GetCapturedFrameCount() const { return capturedFrames; } // frames read back
+    [[nodiscard]] inline int GetDroppedFrameCount() const { return droppedFrames; }
+    [[nodiscard]] inline int GetWrittenFrameCount() const { return writtenFrames; }
+
+private:
+    static constexpr int RING_SIZE = 3;
+
+    struct Readback
+    {
+        unsigned int pbo = 0;
+        void* fence = nullptr; // GLsync
+        size_t size = 0; // the allocated size of the buffer
+        int width = 0, height = 0;
+        std::string file;
+    };
+
+    struct Frame
+    {
+        std::vector<unsigned char> pixels; // RGBA, bottom row first
+        int width = 0, height = 0;
+        std::string file;
+        Format format = Format::PNG;
+        bool keepAlpha = false;
+    };
+
+    void Poll(bool wait); // copy out the finished readbacks from the oldest to the newest (waiting for all of them)
+    void Retrieve(Readback& readback, bool wait);
+    void Enqueue(Frame&& frame);
+    void Flush(); // wait until the encoders are done with the queue
+    void EncodeFrames(); // an encoder thread
+    static bool Write(Frame& frame);
+
+    std::array<Readback, RING_SIZE> ring;
+    int nextSlot = 0;
+    bool capturing = false;
+    std::string prefix;
+    Format format = Format::PNG;
+    int nextFrameNumber = 0;
+    std::atomic<int> capturedFrames{0}, droppedFrames{0}, writtenFrames{0};
+
+    const size_t maxQueuedFrames;
+    std::mutex mutex; // guards the queue, the free buffers and the encoder state
+    std::condition_variable frameQueued, frameTaken;
+    std::deque<Frame> queue;
+    std::vector<std::vector<unsigned char>> freeBuffers; // pixel buffers of written frames to reuse
+    int busyEncoders = 0;
+    bool stopping = false;
+    std::vector<std::thread> encoders;
+};
+
+} // namespace cg3d
@@ -0,0 +1,159 @@
+#include "IdBufferVisitor.h"
+
+#include <GL.h>
+#include "Model.h"
+#include "Scene.h"
+#include "Debug.h"
+#include "GLFW/glfw3.h"
+#include <cstring>
+
+
+namespace cg3d
+{
+
+IdBufferVisitor::~IdBufferVisitor()
+{
+    if (!glfwGetCurrentContext()) return; // the context (and everything in it) is already gone
+
+    for (auto& readback: ring) {
+        if (readback.fence) glDeleteSync(static_cast<GLsync>(readback.fence));
+        if (readback.pbo) glDeleteBuffers(1, &readback.pbo);
+    }
+    glDeleteFramebuffers(1, &frameBuffer);
+    glDeleteTextures(1, &idTexture);
+    glDeleteRenderbuffers(1, &depthBuffer);
+}
+
+void IdBufferVisitor::Resize(int newWidth, int newHeight)
+{
+    if (!frameBuffer) {
+        glGenFramebuffers(1, &frameBuffer);
+        glGenTextures(1, &idTexture);
+        glGenRenderbuffers(1, &depthBuffer);
+        for (auto& readback: ring) {
+            glGenBuffers(1, &readback.pbo);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+            glBufferData(GL_PIXEL_PACK_BUFFER, sizeof(GLuint) + sizeof(GLfloat), nullptr, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    width = newWidth;
+    height = newHeight;
+
+    glBindTexture(GL_TEXTURE_2D, idTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32UI, width, height, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, idTexture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        debug("id buffer frame buffer is not complete");
+
+    debug("id buffer resized to ", width, "x", height);
+}
+
+void IdBufferVisitor::SetPickPosition(int x, int y)
+{
+    pickX = x;
+    pickY = y;
+    hasPickPosition = true;
+}
+
+std::shared_ptr<Model> IdBufferVisitor::GetPickedModel() const
+{
+    return std::dynamic_pointer_cast<Model>(pickedModel.lock());
+}
+
+void IdBufferVisitor::Poll()
+{
+    // go over the pending readbacks from the oldest to the newest, without waiting for any of them
+    for (int i = 0; i < RING_SIZE; i++) {
+        auto& readback = ring[(nextSlot + i) % RING_SIZE];
+        if (!readback.fence) continue;
+
+        auto fence = static_cast<GLsync>(readback.fence);
+        GLenum status = glClientWaitSync(fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) continue;
+        glDeleteSync(fence);
+        readback.fence = nullptr;
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+        if (auto data = static_cast<const GLuint*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, sizeof(GLuint) + sizeof(GLfloat), GL_MAP_READ_BIT))) {
+            GLuint id = data[0];
+            std::memcpy(&pickedDepth, data + 1, sizeof(GLfloat));
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            pickedModel = id > 0 && id <= readback.models.size() ? readback.models[id - 1] : std::weak_ptr<Movable>();
+            hasPickResult = true;
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+}
+
+void IdBufferVisitor::Run(Camera* camera)
+{
+    Poll();
+
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFrameBuffer);
+    if (viewport[2] <= 0 || viewport[3] <= 0) return;
+    if (viewport[2] != width || viewport[3] != height)
+        Resize(viewport[2], viewport[3]);
+
+    models.clear();
+    Visitor::Run(camera);
+
+    // read the pixel into the next buffer of the ring (if the GPU is still busy with it then skip a frame)
+    int x = pickX - viewport[0], y = pickY - viewport[1];
+    auto& readback = ring[nextSlot];
+    if (hasPickPosition && !readback.fence && x >= 0 && y >= 0 && x < width && y < height) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+        glReadPixels(x, y, 1, 1, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+        glReadPixels(x, y, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT, reinterpret_cast<void*>(sizeof(GLuint)));
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        readback.models.swap(models);
+        nextSlot = (nextSlot + 1) % RING_SIZE;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFrameBuffer);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void IdBufferVisitor::Init()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
+    glViewport(0, 0, width, height);
+
+    const GLuint clearId = 0;
+    const GLfloat clearDepth = 1;
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glClearBufferuiv(GL_COLOR, 0, &clearId);
+    glClearBufferfv(GL_DEPTH, 0, &clearDepth);
+    glDisable(GL_STENCIL_TEST);
+    glEnable(GL_DEPTH_TEST);
+}
+
+void IdBufferVisitor::Visit(Model* model)
+{
+    if (!model->isHidden) {
+        auto& program = *model->material->BindFixedIdProgram();
+        scene->Update(program, proj, view, ModelTransform(model));
+        models.emplace_back(model->weak_from_this());
+        program.SetUniform1ui("fixedId", unsigned(models.size())); // 0 is the background
+        model->UpdateDataAndDrawMeshes(program, true, false);
+    }
+
+    Visitor::Visit(model);
+}
+
+} // namespace cg3d
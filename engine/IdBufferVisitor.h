@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Visitor.h"
+#include <array>
+#include <memory>
+#include <vector>
+
+
+namespace cg3d
+{
+
+// renders 32 bit model ids (and depth) into an offscreen integer target and reads the pixel under the cursor back
+// asynchronously through a ring of pixel buffer objects, so picking can run every frame without stalling the pipeline
+// (the results are available a frame or two after the request)
+class IdBufferVisitor : public Visitor
+{
+public:
+    explicit IdBufferVisitor(Scene* scene) : Visitor(scene) {}
+    ~IdBufferVisitor();
+
+    IdBufferVisitor(const IdBufferVisitor&) = delete;
+    void operator=(const IdBufferVisitor&) = delete;
+
+    void Run(Camera* camera) override;
+    void Init() override;
+    void Visit(Model* model) override;
+
+    void SetPickPosition(int x, int y); // the pixel to read back on every run (GL window coordinates, y goes upwards)
+    [[nodiscard]] std::shared_ptr<Model> GetPickedModel() const; // the model of the latest result (null for the background)
+    [[nodiscard]] inline float GetPickedDepth() const { return pickedDepth; } // window depth of the latest result
+    [[nodiscard]] inline bool HasPickResult() const { return hasPickResult; }
+
+private:
+    static constexpr int RING_SIZE = 3;
+
+    struct Readback
+    {
+        unsigned int pbo = 0;
+        void* fence = nullptr; // GLsync
+        std::vector<std::weak_ptr<Movable>> models; // the models drawn with ids 1..n in the frame of the readback
+    };
+
+    void Resize(int width, int height);
+    void Poll();
+
+    unsigned int frameBuffer = 0, idTexture = 0, depthBuffer = 0;
+    int width = 0, height = 0;
+    int viewport[4]{}; // the viewport the visitor was run on
+    int previousFrameBuffer = 0;
+    std::array<Readback, RING_SIZE> ring;
+    int nextSlot = 0;
+    std::vector<std::weak_ptr<Movable>> models;
+    bool hasPickPosition = false;
+    int pickX = 0, pickY = 0;
+    std::weak_ptr<Movable> pickedModel;
+    float pickedDepth = 1;
+    bool hasPickResult = false;
+};
+
+} // namespace cg3d
@@ -0,0 +1,81 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace cg3d
+{
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path)
+{
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        file = nullptr;
+        return;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) return;
+    isOpen = true;
+    size = std::size_t(fileSize.QuadPart);
+    if (size == 0) return; // (empty files can't be mapped)
+
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping != nullptr)
+        data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (data == nullptr) {
+        isOpen = false;
+        size = 0;
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (data != nullptr) UnmapViewOfFile(data);
+    if (mapping != nullptr) CloseHandle(mapping);
+    if (file != nullptr) CloseHandle(file);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+
+    struct stat status{};
+    if (fstat(fd, &status) == 0 && S_ISREG(status.st_mode)) {
+        isOpen = true;
+        size = std::size_t(status.st_size);
+        if (size > 0) { // (empty files can't be mapped)
+            void* address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address != MAP_FAILED) {
+                data = static_cast<const char*>(address);
+                madvise(address, size, MADV_SEQUENTIAL);
+            } else {
+                isOpen = false;
+                size = 0;
+            }
+        }
+    }
+    close(fd); // (the mapping stays valid)
+}
+
+MappedFile::~MappedFile()
+{
+    if (data != nullptr) munmap(const_cast<char*>(data), size);
+}
+
+#endif
+
+} // namespace cg3d
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+
+namespace cg3d
+{
+
+// a read only memory mapping of a whole file (empty if the file can't be opened)
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    void operator=(const MappedFile&) = delete;
+
+    [[nodiscard]] inline bool IsOpen() const { return isOpen; }
+    [[nodiscard]] inline const char* GetData() const { return data; }
+    [[nodiscard]] inline std::size_t GetSize() const { return size; }
+
+private:
+    const char* data = nullptr;
+    std::size_t size = 0;
+    bool isOpen = false;
+#ifdef _WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#endif
+};
+
+} // namespace cg3d
@@ -1,4 +1,5 @@
 #include "Material.h"
+#include "AssetManager.h"
 
 #include <utility>
 
@@ -6,11 +7,11 @@
 namespace cg3d
 {
 
-Material::Material(std::string name, std::shared_ptr<const Program> _program, bool overlay) : name(std::move(name)), program(std::move(_program)),
+Material::Material(std::string name, std::shared_ptr<const Program> _program, bool overlay) : name(std::move(name)), overlay(overlay), program(std::move(_program)),
         fixedColorProgram(make_shared<const Program>(std::move(program->GetVertexShader()), std::move(Shader::GetFixedColorFragmentShader()), overlay, false)) {}
 
 Material::Material(std::string name, const std::string& shaderFileNameWithoutExtension, bool overlay) :
-        Material(std::move(name), std::make_shared<Program>(shaderFileNameWithoutExtension, overlay, true)) {}
+        Material(std::move(name), AssetManager::Global().GetProgram(shaderFileNameWithoutExtension, overlay)) {}
 
 void Material::AddTexture(int slot, std::shared_ptr<Texture> texture)
 {
@@ -20,7 +21,7 @@ void Material::AddTexture(int slot, std::shared_ptr<Texture> texture)
 
 void Material::AddTexture(int slot, const std::string& textureFileName, int dim)
 {
-    AddTexture(slot, std::make_shared<Texture>(textureFileName, dim));
+    AddTexture(slot, AssetManager::Global().GetTexture(textureFileName, dim));
 }
 
 const Program* Material::BindProgram() const
@@ -35,6 +36,14 @@ const Program* Material::BindFixedColorProgram() const
     return fixedColorProgram.get();
 }
 
+const Program* Material::BindFixedIdProgram() const
+{
+    if (!fixedIdProgram)
+        fixedIdProgram = std::make_shared<const Program>(program->GetVertexShader(), Shader::GetFixedIdFragmentShader(), overlay, false);
+    fixedIdProgram->Bind();
+    return fixedIdProgram.get();
+}
+
 void Material::BindTextures() const
 {
     for (int i = 0; i < textures.size(); i++) {
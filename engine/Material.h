@@ -13,6 +13,8 @@ class Material
     std::string name;
     std::vector<std::shared_ptr<Texture>> textures;
     std::vector<int> textureSlots;
+    bool overlay;
+    mutable std::shared_ptr<const Program> fixedIdProgram;
 
 public:
 
@@ -50,6 +52,8 @@ public:
     **/
     void AddTexture(int slot, const std::string &textureFileName, int dim);
 
+    [[nodiscard]] inline const std::string& GetName() const { return name; }
+
     /**
         @brief Binds the main material program
         @retval  - a shared pointer to the program object
@@ -62,6 +66,12 @@ public:
     **/
     const Program* BindFixedColorProgram() const; // NOLINT(modernize-use-nodiscard)
 
+    /**
+        @brief Binds the program writing a fixed unsigned integer id (created on the first use)
+        @retval  - a pointer to the id program object
+    **/
+    const Program* BindFixedIdProgram() const; // NOLINT(modernize-use-nodiscard)
+
     /**
         @brief Binds all associated textures
     **/
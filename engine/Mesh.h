@@ -1,7 +1,14 @@
 #pragma once
 
 #include <Eigen/Core>
+#include <algorithm>
+#include <array>
+#include <cstddef>
 #include <iostream>
+#include <memory>
+#include <span>
+#include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -9,14 +16,161 @@
 namespace cg3d
 {
 
-struct MeshData
+template<typename T> // a dense Eigen matrix or matrix expression (anything with rows, cols and cast)
+concept EigenMatrix = requires(const std::remove_cvref_t<T>& matrix) { matrix.rows(); matrix.cols(); matrix.template cast<float>(); };
+
+/**
+    Geometry of a mesh, stored row major (one vertex or face per row, the layout of the GPU buffers).
+    The data is single precision by default (MeshData), algorithms that need double precision can convert
+    explicitly with Cast<double>() (MeshDataD). Editing goes through the Edit* functions, which track the changes
+    so models showing the mesh know what to update.
+**/
+template<typename Scalar>
+class MeshDataT
 {
-    const Eigen::MatrixXd vertices; // Vertices of the mesh (#V x 3)
-    const Eigen::MatrixXi faces; // Faces of the mesh (#F x 3)
-    const Eigen::MatrixXd vertexNormals; // One normal per vertex
-    const Eigen::MatrixXd textureCoords; // UV vertices
+public:
+    using Matrix = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+    using IndexMatrix = Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+    enum DirtyFlags : unsigned int
+    {
+        DIRTY_NONE = 0,
+        DIRTY_VERTICES = 1 << 0,
+        DIRTY_FACES = 1 << 1,
+        DIRTY_NORMALS = 1 << 2,
+        DIRTY_TEXTURE_COORDS = 1 << 3,
+        DIRTY_ALL = 0xF
+    };
+
+    MeshDataT() = default;
+
+    // accepts matrices and expressions of any scalar type and layout (converted to the storage type,
+    // matrices of the storage type are moved in when passed as rvalues)
+    template<typename V, typename F, typename N, typename T>
+    requires EigenMatrix<V> && EigenMatrix<F> && EigenMatrix<N> && EigenMatrix<T>
+    MeshDataT(V&& vertices, F&& faces, N&& vertexNormals, T&& textureCoords)
+            : vertices(Convert<Matrix>(std::forward<V>(vertices))), faces(Convert<IndexMatrix>(std::forward<F>(faces))),
+              vertexNormals(Convert<Matrix>(std::forward<N>(vertexNormals))), textureCoords(Convert<Matrix>(std::forward<T>(textureCoords))) {}
+
+    [[nodiscard]] inline const Matrix& GetVertices() const { return vertices; } // #V x 3
+    [[nodiscard]] inline const IndexMatrix& GetFaces() const { return faces; } // #F x 3
+    [[nodiscard]] inline const Matrix& GetVertexNormals() const { return vertexNormals; } // one normal per vertex
+    [[nodiscard]] inline const Matrix& GetTextureCoords() const { return textureCoords; } // UV vertices
+
+    inline Matrix& EditVertices() { MarkDirty(DIRTY_VERTICES); return vertices; }
+
+    // like EditVertices, for changes of the given vertices only (lets consumers update just the parts around them)
+    Matrix& EditVertices(const std::vector<int>& indices)
+    {
+        bool continued = hasEditedVertices;
+        MarkDirty(DIRTY_VERTICES);
+        if (!continued) {
+            editedVerticesBase = versions[0] - 1;
+            editedVertices.clear();
+            vertexEdits.clear();
+        }
+        vertexEdits.push_back({versions[0], editedVertices.size()});
+        editedVertices.insert(editedVertices.end(), indices.begin(), indices.end());
+        hasEditedVertices = true;
+
+        // forget the oldest edits once they add up to a quarter of the vertices, keeping the newest ones up to an eighth
+        // (consumers that haven't seen the forgotten ones update whole, more would be cheaper to update whole anyway)
+        std::size_t limit = std::size_t(vertices.rows()) / 4;
+        if (editedVertices.size() > limit) {
+            std::size_t first = 0;
+            while (first + 1 < vertexEdits.size() && editedVertices.size() - vertexEdits[first].offset > limit / 2)
+                first++;
+            std::size_t dropped = vertexEdits[first].offset;
+            if (editedVertices.size() - dropped > limit) { // (a single large edit)
+                hasEditedVertices = false;
+                editedVertices = {};
+                vertexEdits = {};
+                return vertices;
+            }
+            editedVerticesBase = vertexEdits[first].version - 1;
+            editedVertices.erase(editedVertices.begin(), editedVertices.begin() + std::ptrdiff_t(dropped));
+            vertexEdits.erase(vertexEdits.begin(), vertexEdits.begin() + std::ptrdiff_t(first));
+            for (auto& edit: vertexEdits)
+                edit.offset -= dropped;
+        }
+        return vertices;
+    }
+
+    /**
+        @brief Get the vertices edited since a version of the vertices (with EditVertices of the indices)
+        @param seenVersion - the version of the vertices (GetVersions()[0]) the consumer is up to date with
+        @param edited      - set to the vertices (possibly repeated) of the edits after seenVersion
+        @retval            - false if that's unknown (the vertices were edited as a whole, or the edits were forgotten)
+    **/
+    [[nodiscard]] bool GetEditedVertices(unsigned int seenVersion, std::span<const int>& edited) const
+    {
+        if (!hasEditedVertices || seenVersion - editedVerticesBase > versions[0] - editedVerticesBase) return false;
+        auto edit = std::partition_point(vertexEdits.begin(), vertexEdits.end(), [&](const VertexEdit& e) {
+            return e.version - editedVerticesBase <= seenVersion - editedVerticesBase; });
+        std::size_t offset = edit == vertexEdits.end() ? editedVertices.size() : edit->offset;
+        edited = std::span<const int>(editedVertices).subspan(offset);
+        return true;
+    }
+    inline IndexMatrix& EditFaces() { MarkDirty(DIRTY_FACES); return faces; }
+    inline Matrix& EditVertexNormals() { MarkDirty(DIRTY_NORMALS); return vertexNormals; }
+    inline Matrix& EditTextureCoords() { MarkDirty(DIRTY_TEXTURE_COORDS); return textureCoords; }
+
+    // the changes since the last ClearDirty (for a consumer that owns the data), and counters of the changes
+    // of each part (for consumers sharing the data, which compare them with the versions they last saw)
+    [[nodiscard]] inline unsigned int GetDirty() const { return dirty; }
+    inline void ClearDirty(unsigned int flags = DIRTY_ALL) { dirty &= ~flags; }
+    [[nodiscard]] inline const std::array<unsigned int, 4>& GetVersions() const { return versions; }
+    inline void MarkDirty(unsigned int flags)
+    {
+        dirty |= flags;
+        if (flags & (DIRTY_VERTICES | DIRTY_FACES))
+            hasEditedVertices = false;
+        for (int i = 0; i < 4; i++)
+            versions[i] += (flags >> i) & 1;
+    }
+
+    // the parts that changed since the given versions
+    [[nodiscard]] inline unsigned int ChangedSince(const std::array<unsigned int, 4>& seen) const
+    {
+        unsigned int changed = DIRTY_NONE;
+        for (int i = 0; i < 4; i++)
+            changed |= unsigned(versions[i] != seen[i]) << i;
+        return changed;
+    }
+
+    template<typename OtherScalar>
+    [[nodiscard]] MeshDataT<OtherScalar> Cast() const { return {vertices, faces, vertexNormals, textureCoords}; }
+
+private:
+    template<typename Target, typename Source>
+    static Target Convert(Source&& source)
+    {
+        if constexpr (std::is_same_v<std::remove_cvref_t<Source>, Target>)
+            return std::forward<Source>(source);
+        else
+            return source.template cast<typename Target::Scalar>();
+    }
+
+    Matrix vertices;
+    IndexMatrix faces;
+    Matrix vertexNormals;
+    Matrix textureCoords;
+    unsigned int dirty = DIRTY_NONE;
+    std::array<unsigned int, 4> versions{};
+    struct VertexEdit
+    {
+        unsigned int version; // the version of the vertices the edit made
+        std::size_t offset; // the first of its vertices in editedVertices
+    };
+    std::vector<int> editedVertices; // the vertices edited since version editedVerticesBase of the vertices
+    std::vector<VertexEdit> vertexEdits; // the edits in editedVertices, oldest first
+    unsigned int editedVerticesBase = 0;
+    bool hasEditedVertices = false;
 };
 
+using MeshData = MeshDataT<float>;
+using MeshDataD = MeshDataT<double>; // for algorithms that need double precision
+
 class Mesh
 {
 public:
@@ -24,7 +178,9 @@ public:
 
     std::vector<MeshData> data;
 
-    Mesh(std::string name, Eigen::MatrixXd vertices, Eigen::MatrixXi faces, Eigen::MatrixXd vertexNormals, Eigen::MatrixXd textureCoords);
+    template<typename V, typename F, typename N, typename T>
+    Mesh(std::string name, const Eigen::MatrixBase<V>& vertices, const Eigen::MatrixBase<F>& faces, const Eigen::MatrixBase<N>& vertexNormals, const Eigen::MatrixBase<T>& textureCoords)
+            : name(std::move(name)), data{MeshData{vertices, faces, vertexNormals, textureCoords}} {}
     Mesh(std::string name, std::vector<MeshData> data) : name(std::move(name)), data(std::move(data)) {};
     Mesh(const Mesh& mesh) = default;
 
@@ -34,10 +190,10 @@ public:
     static const std::shared_ptr<Mesh>& Octahedron();
     static const std::shared_ptr<Mesh>& Cylinder();
 
-    [[nodiscard]] const Eigen::MatrixXd& GetVertices(int index = 0) const { return data[index].vertices; }
-    [[nodiscard]] const Eigen::MatrixXi& GetFaces(int index = 0) const { return data[index].faces; }
-    [[nodiscard]] const Eigen::MatrixXd& GetVertexNormals(int index = 0) const { return data[index].vertexNormals; }
-    [[nodiscard]] const Eigen::MatrixXd& GetTextureCoords(int index = 0) const { return data[index].textureCoords; }
+    [[nodiscard]] const MeshData::Matrix& GetVertices(int index = 0) const { return data[index].GetVertices(); }
+    [[nodiscard]] const MeshData::IndexMatrix& GetFaces(int index = 0) const { return data[index].GetFaces(); }
+    [[nodiscard]] const MeshData::Matrix& GetVertexNormals(int index = 0) const { return data[index].GetVertexNormals(); }
+    [[nodiscard]] const MeshData::Matrix& GetTextureCoords(int index = 0) const { return data[index].GetTextureCoords(); }
 };
 
 } // namespace cg3d
@@ -0,0 +1,187 @@
+#include "MeshCache.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
+#include "MappedFile.h"
+#include "Debug.h"
+
+namespace fs = std::filesystem;
+
+
+namespace cg3d
+{
+
+namespace
+{
+
+constexpr char MAGIC[8] = {'C', 'G', '3', 'D', 'M', 'S', 'H', '\0'};
+constexpr std::uint64_t BLOCK_ALIGNMENT = 64;
+
+struct FileHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t options;
+    std::uint64_t sourceSize;
+    std::int64_t sourceTime;
+    std::uint32_t meshCount;
+    std::uint32_t reserved;
+};
+
+struct MeshHeader
+{
+    std::uint32_t vertexCount, faceCount, normalCount, uvCount;
+    std::uint64_t offsets[4]; // of the vertices, faces, normals and texture coordinates blocks
+};
+
+bool GetSourceStamp(const std::string& source, std::uint64_t& size, std::int64_t& time)
+{
+    std::error_code error;
+    size = fs::file_size(source, error);
+    if (error) return false;
+    time = std::int64_t(fs::last_write_time(source, error).time_since_epoch().count());
+    return !error;
+}
+
+template<typename Matrix>
+bool ReadBlock(const MappedFile& file, std::uint64_t offset, std::uint32_t rows, int cols, Matrix& matrix)
+{
+    std::uint64_t bytes = std::uint64_t(rows) * cols * sizeof(typename Matrix::Scalar);
+    if (offset % BLOCK_ALIGNMENT != 0 || offset > file.GetSize() || bytes > file.GetSize() - offset) return false;
+    matrix.resize(rows, cols);
+    if (bytes > 0) std::memcpy(matrix.data(), file.GetData() + offset, bytes);
+    return true;
+}
+
+template<typename Matrix>
+void WriteBlock(std::ofstream& out, const Matrix& matrix, std::uint64_t& offset)
+{
+    static const char padding[BLOCK_ALIGNMENT]{};
+    auto bytes = std::uint64_t(matrix.size()) * sizeof(typename Matrix::Scalar);
+    out.write(reinterpret_cast<const char*>(matrix.data()), std::streamsize(bytes));
+    offset += bytes;
+    auto padBytes = (BLOCK_ALIGNMENT - offset % BLOCK_ALIGNMENT) % BLOCK_ALIGNMENT;
+    out.write(padding, std::streamsize(padBytes));
+    offset += padBytes;
+}
+
+} // namespace
+
+std::string MeshCache::CachePath(const std::string& source)
+{
+    if (directory.empty()) return source + ".cgmesh";
+
+    std::error_code error;
+    auto path = fs::weakly_canonical(source, error);
+    std::uint64_t hash = 14695981039346656037ull; // (FNV-1a)
+    for (char c: error ? source : path.string())
+        hash = (hash ^ std::uint8_t(c)) * 1099511628211ull;
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash));
+    return (fs::path(directory) / (fs::path(source).filename().string() + "." + name + ".cgmesh")).string();
+}
+
+bool MeshCache::Load(const std::string& source, unsigned int options, std::vector<MeshData>& dataList)
+{
+    std::uint64_t sourceSize;
+    std::int64_t sourceTime;
+    if (!enabled || !GetSourceStamp(source, sourceSize, sourceTime)) return false;
+
+    MappedFile file(CachePath(source));
+    if (!file.IsOpen() || file.GetSize() < sizeof(FileHeader)) return false;
+    FileHeader header{};
+    std::memcpy(&header, file.GetData(), sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION || header.options != options
+        || header.sourceSize != sourceSize || header.sourceTime != sourceTime
+        || header.meshCount > (file.GetSize() - sizeof(FileHeader)) / sizeof(MeshHeader))
+        return false;
+
+    std::vector<MeshData> loaded;
+    for (std::uint32_t i = 0; i < header.meshCount; i++) {
+        MeshHeader meshHeader{};
+        std::memcpy(&meshHeader, file.GetData() + sizeof(FileHeader) + i * sizeof(MeshHeader), sizeof(meshHeader));
+        MeshData::Matrix V, V_normals, V_uv;
+        MeshData::IndexMatrix F;
+        if (!ReadBlock(file, meshHeader.offsets[0], meshHeader.vertexCount, 3, V) || !ReadBlock(file, meshHeader.offsets[1], meshHeader.faceCount, 3, F)
+            || !ReadBlock(file, meshHeader.offsets[2], meshHeader.normalCount, 3, V_normals) || !ReadBlock(file, meshHeader.offsets[3], meshHeader.uvCount, 2, V_uv))
+            return false;
+        if ((F.size() > 0 && (F.minCoeff() < 0 || F.maxCoeff() >= V.rows()))) return false;
+        loaded.emplace_back(std::move(V), std::move(F), std::move(V_normals), std::move(V_uv));
+    }
+
+    dataList = std::move(loaded);
+    return true;
+}
+
+bool MeshCache::Save(const std::string& source, unsigned int options, const std::vector<MeshData>& dataList)
+{
+    FileHeader header{};
+    if (!enabled || !GetSourceStamp(source, header.sourceSize, header.sourceTime)) return false;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.options = options;
+    header.meshCount = std::uint32_t(dataList.size());
+
+    // the blocks follow the headers, in the order of the meshes
+    std::vector<MeshHeader> meshHeaders(dataList.size());
+    std::uint64_t offset = sizeof(FileHeader) + dataList.size() * sizeof(MeshHeader);
+    auto align = [](std::uint64_t value) { return (value + BLOCK_ALIGNMENT - 1) / BLOCK_ALIGNMENT * BLOCK_ALIGNMENT; };
+    std::uint64_t headerPadding = align(offset) - offset;
+    offset = align(offset);
+    for (std::size_t i = 0; i < dataList.size(); i++) {
+        const auto& data = dataList[i];
+        auto& meshHeader = meshHeaders[i];
+        meshHeader.vertexCount = std::uint32_t(data.GetVertices().rows());
+        meshHeader.faceCount = std::uint32_t(data.GetFaces().rows());
+        meshHeader.normalCount = std::uint32_t(data.GetVertexNormals().rows());
+        meshHeader.uvCount = std::uint32_t(data.GetTextureCoords().rows());
+        std::uint64_t sizes[4]{std::uint64_t(data.GetVertices().size()) * sizeof(float), std::uint64_t(data.GetFaces().size()) * sizeof(int),
+                               std::uint64_t(data.GetVertexNormals().size()) * sizeof(float), std::uint64_t(data.GetTextureCoords().size()) * sizeof(float)};
+        for (int b = 0; b < 4; b++) {
+            meshHeader.offsets[b] = offset;
+            offset = align(offset + sizes[b]);
+        }
+    }
+
+    // write a temporary file and rename it, so readers never see a partial cache file
+    auto path = CachePath(source);
+    auto temporaryPath = path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+    std::error_code error;
+    if (!directory.empty()) fs::create_directories(directory, error);
+    {
+        std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            debug("can't write mesh cache file ", temporaryPath);
+            return false;
+        }
+        static const char padding[BLOCK_ALIGNMENT]{};
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(meshHeaders.data()), std::streamsize(meshHeaders.size() * sizeof(MeshHeader)));
+        out.write(padding, std::streamsize(headerPadding));
+        std::uint64_t written = 0;
+        for (const auto& data: dataList) {
+            WriteBlock(out, data.GetVertices(), written);
+            WriteBlock(out, data.GetFaces(), written);
+            WriteBlock(out, data.GetVertexNormals(), written);
+            WriteBlock(out, data.GetTextureCoords(), written);
+        }
+        if (!out) {
+            out.close();
+            fs::remove(temporaryPath, error);
+            return false;
+        }
+    }
+    fs::rename(temporaryPath, path, error);
+    if (error) {
+        fs::remove(temporaryPath, error);
+        return false;
+    }
+    return true;
+}
+
+} // namespace cg3d
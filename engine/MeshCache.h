@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Mesh.h"
+
+
+namespace cg3d
+{
+
+/**
+    Binary cache of imported meshes, so text files are parsed only the first time they are loaded.
+    A cache file holds aligned blocks of the vertices, normals, texture coordinates and faces of each mesh data,
+    which are copied straight into MeshData. It is written next to the source file (the source path + ".cgmesh"), or in
+    directory if one is set, named by the source file name and a hash of its full path (see CachePath). It is used only
+    while the source size and modification time (and the import options) are the ones it was made from.
+**/
+struct MeshCache
+{
+    static constexpr unsigned int VERSION = 1;
+
+    static inline bool enabled = true;
+    static inline std::string directory; // where to write the cache files (empty for next to the source files)
+
+    static std::string CachePath(const std::string& source); // the path of the cache file of a source file
+
+    /**
+        @brief Load the meshes imported from a source file from its cache file
+        @param source   - path of the source file
+        @param options  - the import options the cache file has to be made with (e.g. whether the meshes were optimized)
+        @param dataList - set to the meshes
+        @retval         - false if there's no valid cache file (or the cache is disabled)
+    **/
+    static bool Load(const std::string& source, unsigned int options, std::vector<MeshData>& dataList);
+    static bool Save(const std::string& source, unsigned int options, const std::vector<MeshData>& dataList);
+};
+
+} // namespace cg3d
@@ -0,0 +1,141 @@
+#include "MeshClusters.h"
+
+#include <algorithm>
+#include <cmath>
+#include "ThreadPool.h"
+
+
+namespace cg3d
+{
+
+MeshClusters::View::View(const Eigen::Matrix4f& proj, const Eigen::Matrix4f& viewModel, bool cullBackfaces)
+        : clipMatrix(proj * viewModel), cullBackfaces(cullBackfaces)
+{
+    Eigen::Matrix4f inverse = viewModel.inverse();
+    eye = inverse.block<3, 1>(0, 3);
+    forward = (inverse.block<3, 3>(0, 0) * Eigen::Vector3f(0, 0, -1)).normalized(); // (the camera looks down -z)
+    orthographic = proj(3, 3) == 1 && proj(3, 2) == 0;
+}
+
+MeshClusters::MeshClusters(const MeshData::Matrix& V, const MeshData::IndexMatrix& F)
+{
+    // split the faces in their order (consecutive faces are usually close, more so after MeshOptimizer)
+    std::vector<int> lastCluster(V.rows(), -1);
+    int vertexCount = 0;
+    for (int f = 0; f < F.rows(); f++) {
+        int newVertices = 0;
+        for (int j = 0; j < 3; j++)
+            newVertices += lastCluster[F(f, j)] != int(clusters.size()) - 1;
+        if (clusters.empty() || clusters.back().faceCount == MAX_FACES || vertexCount + newVertices > MAX_VERTICES) {
+            clusters.emplace_back().firstFace = f;
+            vertexCount = 0;
+            newVertices = 3;
+        }
+        for (int j = 0; j < 3; j++)
+            lastCluster[F(f, j)] = int(clusters.size()) - 1;
+        vertexCount += newVertices;
+        clusters.back().faceCount++;
+    }
+
+    ThreadPool::Global().ParallelFor(0, int(clusters.size()), 64, [this, &V, &F](int begin, int end) {
+        for (int c = begin; c < end; c++)
+            Fit(clusters[c], V, F);
+    });
+}
+
+void MeshClusters::Refit(const MeshData::Matrix& V, const MeshData::IndexMatrix& F, const std::vector<int>& faces)
+{
+    std::vector<int> moved;
+    for (int f: faces) {
+        auto it = std::upper_bound(clusters.begin(), clusters.end(), f, [](int face, const MeshCluster& cluster) { return face < cluster.firstFace; });
+        moved.push_back(int(it - clusters.begin()) - 1);
+    }
+    std::sort(moved.begin(), moved.end());
+    moved.erase(std::unique(moved.begin(), moved.end()), moved.end());
+
+    ThreadPool::Global().ParallelFor(0, int(moved.size()), 64, [this, &V, &F, &moved](int begin, int end) {
+        for (int i = begin; i < end; i++)
+            Fit(clusters[moved[i]], V, F);
+    });
+}
+
+void MeshClusters::Fit(MeshCluster& cluster, const MeshData::Matrix& V, const MeshData::IndexMatrix& F)
+{
+    // bounds and normal cone (as in meshoptimizer)
+    cluster.bounds.setEmpty();
+    cluster.coneCutoff = 2;
+    std::vector<Eigen::Vector3f> normals;
+    Eigen::Vector3f normalSum = Eigen::Vector3f::Zero();
+    for (int f = cluster.firstFace; f < cluster.firstFace + cluster.faceCount; f++) {
+        Eigen::Vector3f p0 = V.row(F(f, 0)), p1 = V.row(F(f, 1)), p2 = V.row(F(f, 2));
+        cluster.bounds.extend(p0).extend(p1).extend(p2);
+        Eigen::Vector3f normal = (p1 - p0).cross(p2 - p0);
+        float length = normal.norm();
+        if (length > 0) { // (degenerate faces don't constrain the cone)
+            normals.push_back(normal / length);
+            normalSum += normals.back();
+        }
+    }
+
+    if (normals.empty() || normalSum.norm() == 0) return;
+    cluster.coneAxis = normalSum.normalized();
+    float minDot = 1;
+    for (const auto& normal: normals)
+        minDot = std::min(minDot, normal.dot(cluster.coneAxis));
+    if (minDot <= 0.1f) return; // the faces point in too many directions
+
+    // move the apex back along the axis until it's behind all the face planes
+    Eigen::Vector3f center = cluster.bounds.center();
+    float maxT = 0;
+    int n = 0;
+    for (int f = cluster.firstFace; f < cluster.firstFace + cluster.faceCount; f++) {
+        Eigen::Vector3f p0 = V.row(F(f, 0)), p1 = V.row(F(f, 1)), p2 = V.row(F(f, 2));
+        if ((p1 - p0).cross(p2 - p0).squaredNorm() == 0) continue;
+        const auto& normal = normals[n++];
+        maxT = std::max(maxT, (center - p0).dot(normal) / cluster.coneAxis.dot(normal));
+    }
+    cluster.coneApex = center - cluster.coneAxis * maxT;
+    cluster.coneCutoff = std::sqrt(1 - minDot * minDot);
+}
+
+void MeshClusters::Cull(const View& view, std::vector<int>& counts, std::vector<const void*>& offsets) const
+{
+    // the planes of the frustum (inside when n.p + d >= 0)
+    Eigen::Matrix<float, 4, 6> planes;
+    for (int i = 0; i < 3; i++) {
+        planes.col(2 * i) = (view.clipMatrix.row(3) + view.clipMatrix.row(i)).transpose();
+        planes.col(2 * i + 1) = (view.clipMatrix.row(3) - view.clipMatrix.row(i)).transpose();
+    }
+
+    std::vector<char> visible(clusters.size());
+    ThreadPool::Global().ParallelFor(0, int(clusters.size()), 256, [&](int begin, int end) {
+        for (int c = begin; c < end; c++) {
+            const auto& cluster = clusters[c];
+            bool inside = !cluster.bounds.isEmpty();
+            for (int i = 0; i < 6 && inside; i++) {
+                auto normal = planes.col(i).head<3>();
+                Eigen::Vector3f farCorner = (normal.array() >= 0).select(cluster.bounds.max(), cluster.bounds.min());
+                inside = normal.dot(farCorner) + planes(3, i) >= 0;
+            }
+            if (inside && view.cullBackfaces && cluster.coneCutoff <= 1) {
+                Eigen::Vector3f direction = view.orthographic ? view.forward : (cluster.coneApex - view.eye).normalized();
+                inside = direction.dot(cluster.coneAxis) < cluster.coneCutoff;
+            }
+            visible[c] = inside;
+        }
+    });
+
+    counts.clear();
+    offsets.clear();
+    for (int c = 0; c < int(clusters.size()); c++) {
+        if (!visible[c]) continue;
+        if (c > 0 && visible[c - 1]) {
+            counts.back() += 3 * clusters[c].faceCount;
+        } else {
+            counts.push_back(3 * clusters[c].faceCount);
+            offsets.push_back(reinterpret_cast<const void*>(std::size_t(clusters[c].firstFace) * 3 * sizeof(unsigned int)));
+        }
+    }
+}
+
+} // namespace cg3d
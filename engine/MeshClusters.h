@@ -0,0 +1,61 @@
+#pragma once
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <vector>
+#include "Mesh.h"
+
+
+namespace cg3d
+{
+
+// a run of consecutive faces of a mesh with its bounds and normal cone
+struct MeshCluster
+{
+    int firstFace = 0, faceCount = 0;
+    Eigen::AlignedBox3f bounds;
+    Eigen::Vector3f coneApex{0, 0, 0}, coneAxis{0, 0, 1};
+    float coneCutoff = 2; // all the faces face away from viewers where dot(normalize(apex - eye), axis) >= cutoff (> 1 never)
+};
+
+// decomposition of a mesh into clusters of up to MAX_FACES faces for culling parts of large meshes
+// (the clusters are consecutive ranges of the faces, so the visible ones can be drawn straight from the index buffer)
+class MeshClusters
+{
+public:
+    static constexpr int MAX_FACES = 128;
+    static constexpr int MAX_VERTICES = 96; // (the clusters stay compact even when the face order jumps)
+    static constexpr int MIN_MESH_FACES = 4096; // smaller meshes are drawn whole
+
+    // the view to cull against, in the model space
+    struct View
+    {
+        Eigen::Matrix4f clipMatrix; // proj * view * model
+        Eigen::Vector3f eye; // the camera position
+        Eigen::Vector3f forward; // the camera direction (for orthographic projections)
+        bool orthographic = false;
+        bool cullBackfaces = false;
+
+        View(const Eigen::Matrix4f& proj, const Eigen::Matrix4f& viewModel, bool cullBackfaces);
+    };
+
+    MeshClusters(const MeshData::Matrix& V, const MeshData::IndexMatrix& F);
+
+    [[nodiscard]] inline const std::vector<MeshCluster>& GetClusters() const { return clusters; }
+
+    /**
+        @brief Find the clusters that may be visible (in parallel), as ranges for glMultiDrawElements
+        @param view    - the view in the model space
+        @param counts  - set to the number of indices of each range (adjacent visible clusters are merged)
+        @param offsets - set to the byte offsets of the ranges in the index buffer
+    **/
+    void Cull(const View& view, std::vector<int>& counts, std::vector<const void*>& offsets) const;
+
+    void Refit(const MeshData::Matrix& V, const MeshData::IndexMatrix& F, const std::vector<int>& faces); // update the clusters of moved faces
+
+private:
+    static void Fit(MeshCluster& cluster, const MeshData::Matrix& V, const MeshData::IndexMatrix& F);
+    std::vector<MeshCluster> clusters;
+};
+
+} // namespace cg3d
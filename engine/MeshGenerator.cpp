@@ -0,0 +1,238 @@
+#include "MeshGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+#include <Eigen/Geometry>
+
+
+namespace cg3d
+{
+
+namespace
+{
+
+constexpr float PI = 3.14159265358979323846f;
+
+constexpr float CUBE_POSITIONS[8][3]{
+        {-0.5f, -0.5f, 0.5f}, {0.5f, -0.5f, 0.5f}, {-0.5f, 0.5f, 0.5f}, {0.5f, 0.5f, 0.5f},
+        {-0.5f, 0.5f, -0.5f}, {0.5f, 0.5f, -0.5f}, {-0.5f, -0.5f, -0.5f}, {0.5f, -0.5f, -0.5f}};
+constexpr int CUBE_QUADS[6][4]{{0, 1, 2, 3}, {2, 3, 4, 5}, {4, 5, 6, 7}, {6, 7, 0, 1}, {1, 7, 3, 5}, {6, 0, 4, 2}}; // triangles 0 1 2 and 2 1 3
+constexpr float QUAD_UVS[4][2]{{0, 0}, {0, 1}, {1, 0}, {1, 1}};
+
+constexpr float TETRAHEDRON_POSITIONS[4][3]{{1, 0, 0}, {0, 1, 0}, {0, 0, 1}, {0, 0, 0}};
+constexpr int TETRAHEDRON_FACES[4][3]{{1, 3, 2}, {3, 1, 0}, {2, 0, 1}, {0, 2, 3}};
+
+constexpr float OCTAHEDRON_POSITIONS[6][3]{{0, 1, 0}, {1, 0, 0}, {0, 0, -1}, {-1, 0, 0}, {0, 0, 1}, {0, -1, 0}};
+constexpr int OCTAHEDRON_FACES[8][3]{{0, 1, 2}, {0, 2, 3}, {0, 3, 4}, {0, 4, 1}, {5, 2, 1}, {5, 3, 2}, {5, 4, 3}, {5, 1, 4}};
+
+struct Vertex
+{
+    Eigen::Vector3f position, normal;
+    Eigen::Vector2f uv;
+};
+
+class Builder
+{
+public:
+    int AddVertex(const Vertex& vertex)
+    {
+        vertices.push_back(vertex);
+        return int(vertices.size()) - 1;
+    }
+
+    void AddFace(int a, int b, int c) { faces.emplace_back(a, b, c); }
+
+    // a grid of (uSegments + 1) x (vSegments + 1) vertices given by vertex(i, j, vertex), with 2 triangles per cell
+    // (the position derivatives along i and along j have to cross into the outside, triangles that collapse at poles are left out)
+    void AddSurface(int uSegments, int vSegments, const std::function<void(int, int, Vertex&)>& vertex)
+    {
+        int first = int(vertices.size());
+        for (int j = 0; j <= vSegments; j++) {
+            for (int i = 0; i <= uSegments; i++) {
+                Vertex v;
+                vertex(i, j, v);
+                vertices.push_back(v);
+            }
+        }
+        auto index = [first, uSegments](int i, int j) { return first + j * (uSegments + 1) + i; };
+        for (int j = 0; j < vSegments; j++) {
+            for (int i = 0; i < uSegments; i++) {
+                AddNonDegenerateFace(index(i, j), index(i + 1, j), index(i, j + 1));
+                AddNonDegenerateFace(index(i, j + 1), index(i + 1, j), index(i + 1, j + 1));
+            }
+        }
+    }
+
+    // a disc of a ring of vertices around a center (facing where the ring turns counterclockwise)
+    void AddDisc(const Eigen::Vector3f& center, int segments, const std::function<Eigen::Vector3f(float)>& ringPoint, const Eigen::Vector3f& normal)
+    {
+        int centerIndex = AddVertex({center, normal, {0.5f, 0.5f}});
+        for (int i = 0; i <= segments; i++) {
+            float angle = 2 * PI * float(i % segments) / float(segments);
+            AddVertex({ringPoint(angle), normal, {0.5f + 0.5f * std::cos(angle), 0.5f + 0.5f * std::sin(angle)}});
+        }
+        for (int i = 0; i < segments; i++)
+            AddFace(centerIndex, centerIndex + 1 + i, centerIndex + 2 + i);
+    }
+
+    MeshData Build() const
+    {
+        MeshData::Matrix V(vertices.size(), 3), V_normals(vertices.size(), 3), V_uv(vertices.size(), 2);
+        MeshData::IndexMatrix F(faces.size(), 3);
+        for (int i = 0; i < int(vertices.size()); i++) {
+            V.row(i) = vertices[i].position.transpose();
+            V_normals.row(i) = vertices[i].normal.transpose();
+            V_uv.row(i) = vertices[i].uv.transpose();
+        }
+        for (int i = 0; i < int(faces.size()); i++)
+            F.row(i) = faces[i].transpose();
+        return {std::move(V), std::move(F), std::move(V_normals), std::move(V_uv)};
+    }
+
+private:
+    void AddNonDegenerateFace(int a, int b, int c)
+    {
+        const auto &pa = vertices[a].position, &pb = vertices[b].position, &pc = vertices[c].position;
+        if (pa != pb && pb != pc && pc != pa)
+            AddFace(a, b, c);
+    }
+
+    std::vector<Vertex> vertices;
+    std::vector<Eigen::Vector3i> faces;
+};
+
+// sine and cosine of angle * pi, exact at the multiples of pi / 2 (so the vertices at poles and seams coincide exactly)
+void SinCosPi(float angle, float& sine, float& cosine)
+{
+    float twice = angle * 2;
+    if (twice == std::round(twice)) {
+        constexpr float SIN[4]{0, 1, 0, -1}, COS[4]{1, 0, -1, 0};
+        int quarter = ((int(std::round(twice)) % 4) + 4) % 4;
+        sine = SIN[quarter], cosine = COS[quarter];
+    } else {
+        sine = std::sin(angle * PI), cosine = std::cos(angle * PI);
+    }
+}
+
+template<int N>
+MeshData FromTable(const float (&positions)[N][3], const int faces[][3], int faceCount)
+{
+    MeshData::Matrix V(N, 3);
+    MeshData::IndexMatrix F(faceCount, 3);
+    for (int i = 0; i < N; i++)
+        V.row(i) << positions[i][0], positions[i][1], positions[i][2];
+    for (int i = 0; i < faceCount; i++)
+        F.row(i) << faces[i][0], faces[i][1], faces[i][2];
+    return {std::move(V), std::move(F), MeshData::Matrix::Zero(N, 3), MeshData::Matrix::Zero(N, 2)}; // (smooth normals are computed when drawn)
+}
+
+} // namespace
+
+MeshData MeshGenerator::Cube()
+{
+    Builder builder;
+    for (const auto& quad: CUBE_QUADS) {
+        Eigen::Vector3f corners[4];
+        for (int k = 0; k < 4; k++)
+            corners[k] = Eigen::Vector3f(CUBE_POSITIONS[quad[k]]);
+        Eigen::Vector3f normal = (corners[1] - corners[0]).cross(corners[2] - corners[0]).normalized();
+        int first = 0;
+        for (int k = 0; k < 4; k++)
+            first = builder.AddVertex({corners[k], normal, Eigen::Vector2f(QUAD_UVS[k])}) - k;
+        builder.AddFace(first, first + 1, first + 2);
+        builder.AddFace(first + 2, first + 1, first + 3);
+    }
+    return builder.Build();
+}
+
+MeshData MeshGenerator::Tetrahedron()
+{
+    return FromTable(TETRAHEDRON_POSITIONS, TETRAHEDRON_FACES, 4);
+}
+
+MeshData MeshGenerator::Octahedron()
+{
+    return FromTable(OCTAHEDRON_POSITIONS, OCTAHEDRON_FACES, 8);
+}
+
+MeshData MeshGenerator::Grid(int xSegments, int ySegments, float width, float height)
+{
+    xSegments = std::max(xSegments, 1), ySegments = std::max(ySegments, 1);
+    Builder builder;
+    builder.AddSurface(xSegments, ySegments, [=](int i, int j, Vertex& vertex) {
+        float u = float(i) / float(xSegments), v = float(j) / float(ySegments);
+        vertex = {{(u - 0.5f) * width, (v - 0.5f) * height, 0}, {0, 0, 1}, {u, v}};
+    });
+    return builder.Build();
+}
+
+MeshData MeshGenerator::Sphere(int segments, int rings, float radius)
+{
+    segments = std::max(segments, 3), rings = std::max(rings, 2);
+    Builder builder;
+    builder.AddSurface(segments, rings, [=](int i, int j, Vertex& vertex) {
+        float u = float(i) / float(segments), v = float(j) / float(rings);
+        float sinTheta, cosTheta, sinPhi, cosPhi;
+        SinCosPi(2 * u, sinTheta, cosTheta);
+        SinCosPi(v, sinPhi, cosPhi); // (from the pole at +y)
+        Eigen::Vector3f normal(sinPhi * cosTheta, cosPhi, sinPhi * sinTheta);
+        vertex = {radius * normal, normal, {u, 1 - v}};
+    });
+    return builder.Build();
+}
+
+MeshData MeshGenerator::Cylinder(int segments, float radius, float length)
+{
+    segments = std::max(segments, 3);
+    Builder builder;
+    builder.AddSurface(segments, 1, [=](int i, int j, Vertex& vertex) {
+        float u = float(i) / float(segments);
+        float sinTheta, cosTheta;
+        SinCosPi(2 * u, sinTheta, cosTheta);
+        Eigen::Vector3f normal(0, cosTheta, sinTheta);
+        vertex = {Eigen::Vector3f((float(j) - 0.5f) * length, 0, 0) + radius * normal, normal, {u, float(j)}};
+    });
+    for (float side: {-1.0f, 1.0f}) {
+        auto ringPoint = [=](float angle) { return Eigen::Vector3f(side * length / 2, radius * std::cos(side * angle), radius * std::sin(side * angle)); };
+        builder.AddDisc({side * length / 2, 0, 0}, segments, ringPoint, {side, 0, 0});
+    }
+    return builder.Build();
+}
+
+MeshData MeshGenerator::Capsule(int segments, int rings, float radius, float length)
+{
+    segments = std::max(segments, 3), rings = std::max(rings, 1);
+    Builder builder;
+    // the rows of the hemisphere at -x then the rows of the one at +x (the cylinder between them is the segment between the equators)
+    builder.AddSurface(segments, 2 * rings + 1, [=](int i, int j, Vertex& vertex) {
+        float u = float(i) / float(segments);
+        int ring = j <= rings ? j : j - 1;
+        float sinTheta, cosTheta, sinPhi, cosPhi;
+        SinCosPi(2 * u, sinTheta, cosTheta);
+        SinCosPi(float(ring) / float(2 * rings), sinPhi, cosPhi);
+        Eigen::Vector3f normal(-cosPhi, sinPhi * cosTheta, sinPhi * sinTheta);
+        Eigen::Vector3f center((j <= rings ? -0.5f : 0.5f) * length, 0, 0);
+        float v = (center.x() + radius * normal.x() + length / 2 + radius) / (length + 2 * radius);
+        vertex = {center + radius * normal, normal, {u, v}};
+    });
+    return builder.Build();
+}
+
+MeshData MeshGenerator::Torus(int segments, int sides, float radius, float tubeRadius)
+{
+    segments = std::max(segments, 3), sides = std::max(sides, 3);
+    Builder builder;
+    builder.AddSurface(segments, sides, [=](int i, int j, Vertex& vertex) {
+        float u = float(i) / float(segments), v = float(j) / float(sides);
+        float sinTheta, cosTheta, sinPhi, cosPhi;
+        SinCosPi(2 * u, sinTheta, cosTheta);
+        SinCosPi(-2 * v, sinPhi, cosPhi); // (around the tube in the direction that winds the faces outwards)
+        Eigen::Vector3f normal(cosPhi * cosTheta, sinPhi, cosPhi * sinTheta);
+        vertex = {Eigen::Vector3f(radius * cosTheta, 0, radius * sinTheta) + tubeRadius * normal, normal, {u, v}};
+    });
+    return builder.Build();
+}
+
+} // namespace cg3d
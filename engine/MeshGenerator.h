@@ -0,0 +1,24 @@
+#pragma once
+
+#include "Mesh.h"
+
+
+namespace cg3d
+{
+
+// meshes generated straight into mesh data (with normals and texture coordinates), the parametric ones at any resolution;
+// the shapes are centered at the origin and their faces are wound counterclockwise seen from the outside
+struct MeshGenerator
+{
+    static MeshData Cube(); // 1 x 1 x 1, a texture per face
+    static MeshData Tetrahedron(); // the corner tetrahedron of the unit cube (no texture coordinates)
+    static MeshData Octahedron(); // vertices at distance 1 on the axes (no texture coordinates)
+
+    static MeshData Grid(int xSegments, int ySegments, float width = 2, float height = 2); // in the xy plane facing +z
+    static MeshData Sphere(int segments, int rings, float radius = 1); // the poles on the y axis
+    static MeshData Cylinder(int segments, float radius = 1, float length = 2); // along the x axis, with caps
+    static MeshData Capsule(int segments, int rings, float radius = 0.5f, float length = 1); // along the x axis, rings per hemisphere
+    static MeshData Torus(int segments, int sides, float radius = 1, float tubeRadius = 0.25f); // around the y axis
+};
+
+} // namespace cg3d
@@ -0,0 +1,90 @@
+#include "MeshNormals.h"
+
+#include <Eigen/Geometry>
+#include <numeric>
+#include <vector>
+#include "ThreadPool.h"
+
+
+namespace cg3d
+{
+
+static constexpr int CHUNK_SIZE = 4096;
+
+static inline Eigen::RowVector3f FaceCross(const MeshData::Matrix& V, const MeshData::IndexMatrix& F, int f) // (length is twice the area)
+{
+    Eigen::RowVector3f p0 = V.row(F(f, 0)), p1 = V.row(F(f, 1)), p2 = V.row(F(f, 2));
+    return (p1 - p0).cross(p2 - p0);
+}
+
+static inline Eigen::RowVector3f UnitOrZero(const Eigen::RowVector3f& normal)
+{
+    float length = normal.norm();
+    return length > 0 ? Eigen::RowVector3f(normal / length) : Eigen::RowVector3f::Zero();
+}
+
+void MeshNormals::PerFace(const MeshData::Matrix& V, const MeshData::IndexMatrix& F, MeshData::Matrix& faceNormals)
+{
+    faceNormals.resize(F.rows(), 3);
+    ThreadPool::Global().ParallelFor(0, int(F.rows()), CHUNK_SIZE, [&](int begin, int end) {
+        for (int f = begin; f < end; f++)
+            faceNormals.row(f) = UnitOrZero(FaceCross(V, F, f));
+    });
+}
+
+void MeshNormals::PerVertex(const MeshData::Matrix& V, const MeshData::IndexMatrix& F, const MeshData::Matrix& faceNormals, MeshData::Matrix& vertexNormals)
+{
+    const int vertexCount = int(V.rows()), faceCount = int(F.rows());
+
+    // twice the areas of the faces
+    std::vector<float> areas(faceCount);
+    ThreadPool::Global().ParallelFor(0, faceCount, CHUNK_SIZE, [&](int begin, int end) {
+        for (int f = begin; f < end; f++)
+            areas[f] = FaceCross(V, F, f).norm();
+    });
+
+    // the faces around each vertex in compressed rows, so each vertex gathers its own sum (no write conflicts)
+    std::vector<int> offsets(vertexCount + 1, 0), adjacency(F.size());
+    for (int f = 0; f < faceCount; f++)
+        for (int j = 0; j < 3; j++)
+            offsets[F(f, j) + 1]++;
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+    for (int f = 0; f < faceCount; f++)
+        for (int j = 0; j < 3; j++)
+            adjacency[fill[F(f, j)]++] = f;
+
+    vertexNormals.resize(vertexCount, 3);
+    ThreadPool::Global().ParallelFor(0, vertexCount, CHUNK_SIZE, [&](int begin, int end) {
+        for (int v = begin; v < end; v++) {
+            Eigen::RowVector3f sum = Eigen::RowVector3f::Zero();
+            for (int i = offsets[v]; i < offsets[v + 1]; i++)
+                sum += areas[adjacency[i]] * faceNormals.row(adjacency[i]);
+            vertexNormals.row(v) = sum.normalized();
+        }
+    });
+}
+
+void MeshNormals::UpdatePerFace(const MeshData::Matrix& V, const MeshData::IndexMatrix& F, const std::vector<int>& faces, MeshData::Matrix& faceNormals)
+{
+    ThreadPool::Global().ParallelFor(0, int(faces.size()), CHUNK_SIZE, [&](int begin, int end) {
+        for (int i = begin; i < end; i++)
+            faceNormals.row(faces[i]) = UnitOrZero(FaceCross(V, F, faces[i]));
+    });
+}
+
+void MeshNormals::UpdatePerVertex(const MeshData::Matrix& V, const MeshData::IndexMatrix& F, const MeshData::Matrix& faceNormals,
+                                  const Eigen::VectorXi& VF, const Eigen::VectorXi& NI, const std::vector<int>& vertices, MeshData::Matrix& vertexNormals)
+{
+    ThreadPool::Global().ParallelFor(0, int(vertices.size()), CHUNK_SIZE, [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            int v = vertices[i];
+            Eigen::RowVector3f sum = Eigen::RowVector3f::Zero();
+            for (int j = NI(v); j < NI(v + 1); j++)
+                sum += FaceCross(V, F, VF(j)).norm() * faceNormals.row(VF(j));
+            vertexNormals.row(v) = sum.normalized();
+        }
+    });
+}
+
+} // namespace cg3d
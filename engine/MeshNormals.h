@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+#include "Mesh.h"
+
+
+namespace cg3d
+{
+
+// normals of triangle meshes computed in parallel on the thread pool (same results as igl::per_face_normals and
+// igl::per_vertex_normals with area weighting, without their serial scatter over the faces), in the single precision
+// of the mesh data
+struct MeshNormals
+{
+    // unit normals of the faces (zero for degenerate faces)
+    static void PerFace(const MeshData::Matrix& V, const MeshData::IndexMatrix& F, MeshData::Matrix& faceNormals);
+
+    // unit normals of the vertices, the normals of the faces around each vertex weighted by their areas
+    // (zero for vertices that aren't used by any face)
+    static void PerVertex(const MeshData::Matrix& V, const MeshData::IndexMatrix& F, const MeshData::Matrix& faceNormals, MeshData::Matrix& vertexNormals);
+
+    // recompute the normals of some of the faces and vertices (after the vertices around them moved), using the
+    // vertex-face adjacency from igl::vertex_triangle_adjacency (the faces of vertex v are VF[NI[v]..NI[v + 1]))
+    static void UpdatePerFace(const MeshData::Matrix& V, const MeshData::IndexMatrix& F, const std::vector<int>& faces, MeshData::Matrix& faceNormals);
+    static void UpdatePerVertex(const MeshData::Matrix& V, const MeshData::IndexMatrix& F, const MeshData::Matrix& faceNormals,
+                                const Eigen::VectorXi& VF, const Eigen::VectorXi& NI, const std::vector<int>& vertices, MeshData::Matrix& vertexNormals);
+};
+
+} // namespace cg3d
@@ -0,0 +1,203 @@
+#include "MeshOptimizer.h"
+
+#include <Eigen/Geometry>
+#include <algorithm>
+#include <numeric>
+
+
+namespace cg3d
+{
+
+MeshOptimizer::Report MeshOptimizer::Optimize(MeshData& meshData, const Options& options)
+{
+    Report report;
+    const auto& faces = meshData.GetFaces();
+    int vertexCount = int(meshData.GetVertices().rows());
+    if (faces.rows() == 0 || faces.cols() != 3) return report;
+
+    report.acmrBefore = CalcAcmr(faces, vertexCount, options.cacheSize);
+    report.atvrBefore = report.acmrBefore * float(faces.rows()) / float(vertexCount);
+
+    auto& editedFaces = meshData.EditFaces();
+    auto clusters = OptimizeVertexCache(editedFaces, vertexCount, options.cacheSize);
+    report.clusterCount = int(clusters.size());
+    if (options.reduceOverdraw)
+        OptimizeOverdraw(editedFaces, meshData.GetVertices(), clusters);
+    if (options.reorderVertices)
+        OptimizeVertexFetch(meshData);
+
+    report.acmrAfter = CalcAcmr(meshData.GetFaces(), vertexCount, options.cacheSize);
+    report.atvrAfter = report.acmrAfter * float(faces.rows()) / float(vertexCount);
+
+    return report;
+}
+
+float MeshOptimizer::CalcAcmr(const MeshData::IndexMatrix& faces, int vertexCount, int cacheSize)
+{
+    if (faces.rows() == 0) return 0;
+
+    std::vector<int> insertedAt(vertexCount, -cacheSize - 1); // the miss counter when the vertex entered the cache
+    int misses = 0;
+    for (int i = 0; i < faces.size(); i++) {
+        int v = faces.data()[i];
+        if (misses - insertedAt[v] > cacheSize) // a FIFO cache holds the last cacheSize misses
+            insertedAt[v] = misses++;
+    }
+
+    return float(misses) / float(faces.rows());
+}
+
+std::vector<int> MeshOptimizer::OptimizeVertexCache(MeshData::IndexMatrix& faces, int vertexCount, int cacheSize)
+{
+    // Tipsify (Sander, Nehab and Barczak 2007): fan around a vertex, then continue from the most recently used
+    // vertex that will still be in the cache, or skip to a vertex from a stack of dead ends
+    const int faceCount = int(faces.rows());
+
+    // vertex-triangle adjacency in compressed rows
+    std::vector<int> offsets(vertexCount + 1, 0), adjacency(faceCount * 3);
+    for (int i = 0; i < faces.size(); i++)
+        offsets[faces.data()[i] + 1]++;
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    std::vector<int> liveTriangles(vertexCount), fill(offsets.begin(), offsets.end() - 1);
+    for (int f = 0; f < faceCount; f++)
+        for (int j = 0; j < 3; j++)
+            adjacency[fill[faces(f, j)]++] = f;
+    for (int v = 0; v < vertexCount; v++)
+        liveTriangles[v] = offsets[v + 1] - offsets[v];
+
+    std::vector<int> timestamps(vertexCount, 0), deadEnds, candidates, order, clusters;
+    std::vector<bool> emitted(faceCount, false);
+    order.reserve(faceCount);
+    int time = cacheSize + 1, cursor = 0;
+
+    auto skipDeadEnd = [&]() {
+        while (!deadEnds.empty()) {
+            int v = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveTriangles[v] > 0) return v;
+        }
+        for (; cursor < vertexCount; cursor++)
+            if (liveTriangles[cursor] > 0) return cursor;
+        return -1;
+    };
+
+    for (int fanning = skipDeadEnd(); fanning >= 0;) {
+        if (order.empty() || clusters.empty() || clusters.back() != int(order.size()))
+            clusters.push_back(int(order.size()));
+
+        do {
+            candidates.clear();
+            for (int i = offsets[fanning]; i < offsets[fanning + 1]; i++) {
+                int f = adjacency[i];
+                if (emitted[f]) continue;
+                emitted[f] = true;
+                order.push_back(f);
+                for (int j = 0; j < 3; j++) {
+                    int v = faces(f, j);
+                    deadEnds.push_back(v);
+                    candidates.push_back(v);
+                    liveTriangles[v]--;
+                    if (time - timestamps[v] > cacheSize)
+                        timestamps[v] = time++;
+                }
+            }
+
+            // the candidate that will still be in the cache after its remaining triangles are emitted, the oldest first
+            int next = -1, best = -1;
+            for (int v: candidates) {
+                if (liveTriangles[v] <= 0) continue;
+                int priority = 0;
+                if (time - timestamps[v] + 2 * liveTriangles[v] <= cacheSize)
+                    priority = time - timestamps[v];
+                if (priority > best) {
+                    best = priority;
+                    next = v;
+                }
+            }
+            fanning = next;
+        } while (fanning >= 0);
+
+        fanning = skipDeadEnd(); // a jump to another part of the mesh starts a new cluster
+    }
+
+    MeshData::IndexMatrix reordered(faceCount, 3);
+    for (int i = 0; i < faceCount; i++)
+        reordered.row(i) = faces.row(order[i]);
+    faces = std::move(reordered);
+
+    return clusters;
+}
+
+void MeshOptimizer::OptimizeOverdraw(MeshData::IndexMatrix& faces, const MeshData::Matrix& vertices, const std::vector<int>& clusters)
+{
+    const int faceCount = int(faces.rows());
+    if (clusters.size() < 2) return;
+
+    // area weighted centers and normals of the clusters and of the whole mesh
+    std::vector<Eigen::Vector3f> centers(clusters.size(), Eigen::Vector3f::Zero()), normals(clusters.size(), Eigen::Vector3f::Zero());
+    std::vector<float> areas(clusters.size(), 0);
+    Eigen::Vector3f meshCenter = Eigen::Vector3f::Zero();
+    float meshArea = 0;
+    for (int c = 0; c < int(clusters.size()); c++) {
+        int end = c + 1 < int(clusters.size()) ? clusters[c + 1] : faceCount;
+        for (int f = clusters[c]; f < end; f++) {
+            Eigen::Vector3f a = vertices.row(faces(f, 0)), b = vertices.row(faces(f, 1)), d = vertices.row(faces(f, 2));
+            Eigen::Vector3f normal = (b - a).cross(d - a); // length is twice the area
+            float area = normal.norm();
+            centers[c] += area * (a + b + d) / 3;
+            normals[c] += normal;
+            areas[c] += area;
+        }
+        meshCenter += centers[c];
+        meshArea += areas[c];
+    }
+    if (meshArea <= 0) return;
+    meshCenter /= meshArea;
+
+    // clusters facing away from the center are less likely to be occluded, draw them first
+    std::vector<float> keys(clusters.size());
+    for (int c = 0; c < int(clusters.size()); c++)
+        keys[c] = areas[c] > 0 ? (centers[c] / areas[c] - meshCenter).dot(normals[c].normalized()) : 0;
+
+    std::vector<int> sorted(clusters.size());
+    std::iota(sorted.begin(), sorted.end(), 0);
+    std::stable_sort(sorted.begin(), sorted.end(), [&keys](int a, int b) { return keys[a] > keys[b]; });
+
+    MeshData::IndexMatrix reordered(faceCount, 3);
+    int row = 0;
+    for (int c: sorted) {
+        int end = c + 1 < int(clusters.size()) ? clusters[c + 1] : faceCount;
+        for (int f = clusters[c]; f < end; f++)
+            reordered.row(row++) = faces.row(f);
+    }
+    faces = std::move(reordered);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(MeshData& meshData)
+{
+    const int vertexCount = int(meshData.GetVertices().rows());
+
+    std::vector<int> remap(vertexCount, -1);
+    int next = 0;
+    auto& faces = meshData.EditFaces();
+    for (int i = 0; i < faces.size(); i++) {
+        int& v = faces.data()[i];
+        if (remap[v] < 0) remap[v] = next++;
+        v = remap[v];
+    }
+    for (int v = 0; v < vertexCount; v++)
+        if (remap[v] < 0) remap[v] = next++;
+
+    auto permute = [&remap](MeshData::Matrix& matrix) {
+        if (matrix.rows() != int(remap.size())) return;
+        MeshData::Matrix permuted(matrix.rows(), matrix.cols());
+        for (int v = 0; v < int(remap.size()); v++)
+            permuted.row(remap[v]) = matrix.row(v);
+        matrix = std::move(permuted);
+    };
+    permute(meshData.EditVertices());
+    permute(meshData.EditVertexNormals());
+    permute(meshData.EditTextureCoords());
+}
+
+} // namespace cg3d
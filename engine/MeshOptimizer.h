@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Mesh.h"
+
+
+namespace cg3d
+{
+
+// reordering of mesh data for faster drawing: triangle order for the post-transform vertex cache (Tipsify),
+// cluster order against overdraw, and vertex order for memory locality of the vertex fetch
+struct MeshOptimizer
+{
+    struct Options
+    {
+        int cacheSize = 16; // the vertex cache size to optimize for
+        bool reduceOverdraw = true; // sort the triangle clusters from the outside in (costs a little of the cache efficiency)
+        bool reorderVertices = true;
+    };
+
+    struct Report
+    {
+        float acmrBefore = 0, acmrAfter = 0; // average cache misses per triangle (0.5 is the best possible, 3 the worst)
+        float atvrBefore = 0, atvrAfter = 0; // average transformed vertices per vertex (1 is the best possible)
+        int clusterCount = 0;
+    };
+
+    static Report Optimize(MeshData& meshData, const Options& options);
+    static Report Optimize(MeshData& meshData) { return Optimize(meshData, Options()); }
+
+    /**
+        @brief Simulate a FIFO vertex cache
+        @param faces       - the triangles (#F x 3)
+        @param vertexCount - the number of vertices
+        @param cacheSize   - the number of entries in the cache
+        @retval            - the average number of cache misses per triangle
+    **/
+    static float CalcAcmr(const MeshData::IndexMatrix& faces, int vertexCount, int cacheSize = 16);
+
+    // reorder the triangles for the vertex cache, returns the indices of the first triangles of the clusters
+    // (where the order had to jump to a new part of the mesh)
+    static std::vector<int> OptimizeVertexCache(MeshData::IndexMatrix& faces, int vertexCount, int cacheSize = 16);
+
+    // sort the clusters so triangles facing out of the mesh are drawn first (Sander et al. 2007)
+    static void OptimizeOverdraw(MeshData::IndexMatrix& faces, const MeshData::Matrix& vertices, const std::vector<int>& clusters);
+
+    // renumber the vertices by their first use in the faces (unused vertices are moved to the end)
+    static void OptimizeVertexFetch(MeshData& meshData);
+};
+
+} // namespace cg3d
@@ -0,0 +1,676 @@
+#include "MeshReader.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <unordered_map>
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "ObjLoader.h"
+#include "ObjParser.h"
+#include "ThreadPool.h"
+#include "Debug.h"
+
+namespace fs = std::filesystem;
+
+
+namespace cg3d
+{
+
+namespace
+{
+
+inline bool IsLineSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+inline bool IsSpace(char c) { return IsLineSpace(c) || c == '\n' || c == '\f' || c == '\v'; }
+
+inline const char* LineEnd(const char* p, const char* end)
+{
+    auto lineEnd = static_cast<const char*>(std::memchr(p, '\n', std::size_t(end - p)));
+    return lineEnd == nullptr ? end : lineEnd;
+}
+
+// parse a number after spaces of the line (false if there's none)
+template<typename T>
+inline bool ParseNumber(const char*& p, const char* end, T& value)
+{
+    while (p < end && IsLineSpace(*p)) p++;
+    if (p < end && *p == '+') p++; // (from_chars doesn't take a plus sign)
+    auto result = std::from_chars(p, end, value);
+    if (result.ec != std::errc()) return false;
+    p = result.ptr;
+    return true;
+}
+
+// the next word of a header, skipping spaces, line ends and # comments
+std::string_view NextWord(const char*& p, const char* end)
+{
+    for (;;) {
+        while (p < end && IsSpace(*p)) p++;
+        if (p < end && *p == '#') p = LineEnd(p, end);
+        else break;
+    }
+    const char* word = p;
+    while (p < end && !IsSpace(*p)) p++;
+    return {word, std::size_t(p - word)};
+}
+
+template<typename T>
+bool ParseWord(const char*& p, const char* end, T& value)
+{
+    auto word = NextWord(p, end);
+    return !word.empty() && std::from_chars(word.data(), word.data() + word.size(), value).ptr == word.data() + word.size();
+}
+
+// bounds of about equal chunks of a text, split at line ends (one chunk for small texts)
+std::vector<const char*> ChunkBounds(const char* begin, const char* end)
+{
+    std::size_t size = end - begin;
+    int chunkCount = int(std::max<std::size_t>(1, std::min<std::size_t>(size / ObjParser::MIN_CHUNK_SIZE, 4 * (ThreadPool::Global().GetThreadCount() + 1))));
+    std::vector<const char*> bounds{begin};
+    for (int i = 1; i < chunkCount; i++) {
+        const char* bound = std::max(begin + size * i / chunkCount, bounds.back());
+        const char* lineEnd = LineEnd(bound, end);
+        bounds.push_back(lineEnd == end ? end : lineEnd + 1);
+    }
+    bounds.push_back(end);
+    return bounds;
+}
+
+inline bool IsRecord(const char* line, const char* lineEnd) // (not blank or a comment)
+{
+    while (line < lineEnd && IsLineSpace(*line)) line++;
+    return line < lineEnd && *line != '#';
+}
+
+/**
+    Call parse(chunk, record, line, lineEnd) for each record of a text of one record per line (skipping blank and comment lines)
+    with the index of the record in the text, parsing chunks of lines in parallel (records are counted in a first pass).
+    Returns the number of records.
+**/
+template<typename Parse>
+std::int64_t ParseRecords(const std::vector<const char*>& bounds, const Parse& parse)
+{
+    const int chunkCount = int(bounds.size()) - 1;
+    std::vector<std::int64_t> firstRecords(chunkCount + 1, 0);
+    auto& threadPool = ThreadPool::Global();
+    threadPool.ParallelFor(0, chunkCount, 1, [&](int chunkBegin, int chunkEnd) {
+        for (int c = chunkBegin; c < chunkEnd; c++)
+            for (const char* line = bounds[c]; line < bounds[c + 1];) {
+                const char* lineEnd = LineEnd(line, bounds[c + 1]);
+                firstRecords[c + 1] += IsRecord(line, lineEnd);
+                line = lineEnd + 1;
+            }
+    });
+    for (int c = 0; c < chunkCount; c++)
+        firstRecords[c + 1] += firstRecords[c];
+
+    threadPool.ParallelFor(0, chunkCount, 1, [&](int chunkBegin, int chunkEnd) {
+        for (int c = chunkBegin; c < chunkEnd; c++) {
+            std::int64_t record = firstRecords[c];
+            for (const char* line = bounds[c]; line < bounds[c + 1];) {
+                const char* lineEnd = LineEnd(line, bounds[c + 1]);
+                if (IsRecord(line, lineEnd))
+                    parse(c, record++, line, lineEnd);
+                line = lineEnd + 1;
+            }
+        }
+    });
+    return firstRecords[chunkCount];
+}
+
+// add a polygon as a fan of triangles (unless it refers to missing vertices)
+void AddPolygon(const std::vector<int>& polygon, int vertexCount, std::vector<int>& triangles)
+{
+    if (polygon.size() < 3 || std::any_of(polygon.begin(), polygon.end(), [vertexCount](int v) { return v < 0 || v >= vertexCount; }))
+        return;
+    for (std::size_t i = 1; i + 1 < polygon.size(); i++)
+        triangles.insert(triangles.end(), {polygon[0], polygon[i], polygon[i + 1]});
+}
+
+// the faces of the triangles of each chunk, in the chunk order
+MeshData::IndexMatrix GatherFaces(const std::vector<std::vector<int>>& chunkTriangles)
+{
+    std::vector<std::size_t> offsets{0};
+    for (const auto& triangles: chunkTriangles)
+        offsets.push_back(offsets.back() + triangles.size());
+    MeshData::IndexMatrix F(offsets.back() / 3, 3);
+    ThreadPool::Global().ParallelFor(0, int(chunkTriangles.size()), 1, [&](int chunkBegin, int chunkEnd) {
+        for (int c = chunkBegin; c < chunkEnd; c++)
+            std::copy(chunkTriangles[c].begin(), chunkTriangles[c].end(), F.data() + offsets[c]);
+    });
+    return F;
+}
+
+// a mesh of separate triangles (9 coordinates each), welding the corners at the same position
+MeshData WeldTriangles(const std::vector<float>& corners)
+{
+    struct PositionHash
+    {
+        std::size_t operator()(const std::array<float, 3>& p) const
+        {
+            auto bits = [](float x) { return std::size_t(std::bit_cast<std::uint32_t>(x + 0.0f)); }; // (+ 0 makes -0 into 0)
+            return bits(p[0]) * 73856093u ^ bits(p[1]) * 19349663u ^ bits(p[2]) * 83492791u;
+        }
+    };
+
+    const int n = int(corners.size() / 3);
+    std::unordered_map<std::array<float, 3>, int, PositionHash> vertexIndices;
+    vertexIndices.reserve(std::size_t(n) / 4);
+    std::vector<float> positions;
+    MeshData::IndexMatrix F(n / 3, 3);
+    for (int i = 0; i < n; i++) {
+        std::array<float, 3> p{corners[3 * i], corners[3 * i + 1], corners[3 * i + 2]};
+        auto [it, isNew] = vertexIndices.try_emplace(p, int(positions.size() / 3));
+        if (isNew) positions.insert(positions.end(), p.begin(), p.end());
+        F(i / 3, i % 3) = it->second;
+    }
+
+    const int vertexCount = int(positions.size() / 3);
+    MeshData::Matrix V = Eigen::Map<const MeshData::Matrix>(positions.data(), vertexCount, 3);
+    return {std::move(V), std::move(F), MeshData::Matrix::Zero(vertexCount, 3), MeshData::Matrix::Zero(vertexCount, 2)};
+}
+
+// PLY headers
+
+enum class PlyType { NONE, INT8, UINT8, INT16, UINT16, INT32, UINT32, FLOAT32, FLOAT64 };
+
+constexpr int PLY_TYPE_SIZES[]{0, 1, 1, 2, 2, 4, 4, 4, 8};
+
+PlyType ParsePlyType(std::string_view name)
+{
+    constexpr std::pair<std::string_view, PlyType> TYPES[]{
+            {"char", PlyType::INT8}, {"int8", PlyType::INT8}, {"uchar", PlyType::UINT8}, {"uint8", PlyType::UINT8},
+            {"short", PlyType::INT16}, {"int16", PlyType::INT16}, {"ushort", PlyType::UINT16}, {"uint16", PlyType::UINT16},
+            {"int", PlyType::INT32}, {"int32", PlyType::INT32}, {"uint", PlyType::UINT32}, {"uint32", PlyType::UINT32},
+            {"float", PlyType::FLOAT32}, {"float32", PlyType::FLOAT32}, {"double", PlyType::FLOAT64}, {"float64", PlyType::FLOAT64}};
+    for (const auto& [typeName, type]: TYPES)
+        if (name == typeName) return type;
+    return PlyType::NONE;
+}
+
+struct PlyProperty
+{
+    PlyType type = PlyType::NONE, countType = PlyType::NONE; // (the count type of a list, NONE for a scalar)
+    int target = -1; // of the vertex element: the column of x y z nx ny nz u v, of the face element: 0 for the vertex indices
+};
+
+struct PlyElement
+{
+    std::string name;
+    std::int64_t count = 0;
+    std::vector<PlyProperty> properties;
+
+    [[nodiscard]] bool HasLists() const
+    {
+        return std::any_of(properties.begin(), properties.end(), [](const PlyProperty& property) { return property.countType != PlyType::NONE; });
+    }
+
+    [[nodiscard]] int GetStride() const // (of the binary records of an element without lists)
+    {
+        int stride = 0;
+        for (const auto& property: properties)
+            stride += PLY_TYPE_SIZES[int(property.type)];
+        return stride;
+    }
+};
+
+int PlyVertexTarget(std::string_view name)
+{
+    constexpr std::pair<std::string_view, int> TARGETS[]{
+            {"x", 0}, {"y", 1}, {"z", 2}, {"nx", 3}, {"ny", 4}, {"nz", 5},
+            {"u", 6}, {"v", 7}, {"s", 6}, {"t", 7}, {"texture_u", 6}, {"texture_v", 7}};
+    for (const auto& [targetName, target]: TARGETS)
+        if (name == targetName) return target;
+    return -1;
+}
+
+inline double ReadPlyValue(const char* p, PlyType type, bool swap)
+{
+    unsigned char bytes[8];
+    int size = PLY_TYPE_SIZES[int(type)];
+    std::memcpy(bytes, p, size);
+    if (swap) std::reverse(bytes, bytes + size);
+    auto as = [&bytes](auto value) { std::memcpy(&value, bytes, sizeof(value)); return double(value); };
+    switch (type) {
+        case PlyType::INT8: return as(std::int8_t());
+        case PlyType::UINT8: return as(std::uint8_t());
+        case PlyType::INT16: return as(std::int16_t());
+        case PlyType::UINT16: return as(std::uint16_t());
+        case PlyType::INT32: return as(std::int32_t());
+        case PlyType::UINT32: return as(std::uint32_t());
+        case PlyType::FLOAT32: return as(float());
+        case PlyType::FLOAT64: return as(double());
+        default: return 0;
+    }
+}
+
+// the vertices and faces of a PLY file being read
+struct PlyMesh
+{
+    MeshData::Matrix V, V_normals, V_uv;
+    bool hasTarget[8]{};
+
+    void SetVertex(std::int64_t v, int target, double value)
+    {
+        if (target < 3) V(v, target) = float(value);
+        else if (target < 6) V_normals(v, target - 3) = float(value);
+        else V_uv(v, target - 6) = float(value);
+    }
+};
+
+} // namespace
+
+std::vector<MeshData> MeshReader::MeshDataListFromFile(const std::string& file)
+{
+    std::string extension = fs::path(file).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return char(std::tolower(c)); });
+    if (extension == ".obj")
+        return ObjLoader::MeshDataListFromObjFile(file);
+
+    std::vector<MeshData> dataList;
+    if (MeshCache::Load(file, unsigned(optimizeMeshes), dataList))
+        return dataList;
+
+    MeshData meshData;
+    bool isRead = extension == ".off" ? ReadOff(file, meshData)
+                  : extension == ".ply" ? ReadPly(file, meshData)
+                  : extension == ".stl" ? ReadStl(file, meshData)
+                  : false;
+    if (!isRead) {
+        debug("can't read mesh file ", file);
+        return {};
+    }
+    if (optimizeMeshes && meshData.GetFaces().rows() > 0) {
+        auto report = MeshOptimizer::Optimize(meshData);
+        debug("mesh ", file, ": ACMR ", report.acmrBefore, " -> ", report.acmrAfter, ", ATVR ", report.atvrBefore, " -> ", report.atvrAfter);
+    }
+    meshData.ClearDirty();
+    dataList.push_back(std::move(meshData));
+    MeshCache::Save(file, unsigned(optimizeMeshes), dataList);
+    return dataList;
+}
+
+std::shared_ptr<Mesh> MeshReader::MeshFromFile(std::string name, const std::string& file)
+{
+    auto dataList = MeshDataListFromFile(file);
+    return dataList.empty() ? nullptr : std::make_shared<Mesh>(std::move(name), std::move(dataList));
+}
+
+bool MeshReader::ReadOff(const std::string& file, MeshData& meshData)
+{
+    MappedFile mappedFile(file);
+    return mappedFile.IsOpen() && ReadOff(mappedFile.GetData(), mappedFile.GetData() + mappedFile.GetSize(), meshData);
+}
+
+bool MeshReader::ReadOff(const char* begin, const char* end, MeshData& meshData)
+{
+    // the header: the keyword (OFF, COFF, NOFF or CNOFF) and the vertex, face and edge counts
+    const char* p = begin;
+    auto keyword = NextWord(p, end);
+    if (keyword.size() < 3 || keyword.substr(keyword.size() - 3) != "OFF" || keyword.find_first_not_of("CN") < keyword.size() - 3)
+        return false;
+    bool hasNormals = keyword.find('N') != std::string_view::npos;
+    int vertexCount, faceCount, edgeCount;
+    if (!ParseWord(p, end, vertexCount) || !ParseWord(p, end, faceCount) || !ParseWord(p, end, edgeCount) || vertexCount < 0 || faceCount < 0)
+        return false;
+    p = std::min(LineEnd(p, end) + 1, end);
+
+    // a vertex (x y z [nx ny nz] [color]) or a face (n i1 ... in [color]), given next(value), which parses the next number
+    MeshData::Matrix V(vertexCount, 3), V_normals = MeshData::Matrix::Zero(vertexCount, 3);
+    auto parseRecord = [&](std::int64_t record, const auto& next, std::vector<int>& polygon, std::vector<int>& triangles) {
+        if (record < vertexCount) {
+            float *position = V.row(record).data(), *normal = V_normals.row(record).data();
+            return next(position[0]) && next(position[1]) && next(position[2]) && (!hasNormals || (next(normal[0]) && next(normal[1]) && next(normal[2])));
+        }
+        int n;
+        if (!next(n) || n < 0) return false;
+        polygon.resize(n);
+        for (int& v: polygon)
+            if (!next(v)) return false;
+        AddPolygon(polygon, vertexCount, triangles);
+        return true;
+    };
+    const std::int64_t recordCount = std::int64_t(vertexCount) + faceCount;
+
+    // a record per line, parsed in parallel
+    auto bounds = ChunkBounds(p, end);
+    std::vector<std::vector<int>> chunkTriangles(bounds.size() - 1), chunkPolygons(bounds.size() - 1);
+    std::atomic<bool> isLineBased = true;
+    auto lineCount = ParseRecords(bounds, [&](int chunk, std::int64_t record, const char* line, const char* lineEnd) {
+        auto next = [&line, lineEnd](auto& value) { return ParseNumber(line, lineEnd, value); };
+        if (record < recordCount && !parseRecord(record, next, chunkPolygons[chunk], chunkTriangles[chunk]))
+            isLineBased = false;
+    });
+
+    MeshData::IndexMatrix F;
+    if (isLineBased && lineCount >= recordCount) {
+        F = GatherFaces(chunkTriangles);
+    } else {
+        // some records are split over lines (which the format allows): parse the numbers in sequence (a record ends at the end of the line of its last number)
+        std::vector<int> triangles, polygon;
+        auto next = [&p, end](auto& value) { return ParseWord(p, end, value); };
+        for (std::int64_t record = 0; record < recordCount; record++) {
+            if (!parseRecord(record, next, polygon, triangles)) return false;
+            p = std::min(LineEnd(p, end) + 1, end);
+        }
+        F = Eigen::Map<const MeshData::IndexMatrix>(triangles.data(), std::int64_t(triangles.size() / 3), 3);
+    }
+
+    meshData = {std::move(V), std::move(F), std::move(V_normals), MeshData::Matrix::Zero(vertexCount, 2)};
+    return true;
+}
+
+bool MeshReader::ReadPly(const std::string& file, MeshData& meshData)
+{
+    MappedFile mappedFile(file);
+    return mappedFile.IsOpen() && ReadPly(mappedFile.GetData(), mappedFile.GetData() + mappedFile.GetSize(), meshData);
+}
+
+bool MeshReader::ReadPly(const char* begin, const char* end, MeshData& meshData)
+{
+    // the header: the format and the elements with their properties
+    const char* p = begin;
+    if (NextWord(p, end) != "ply") return false;
+    std::string_view format;
+    std::vector<PlyElement> elements;
+    for (;;) {
+        const char* lineEnd = LineEnd(p, end);
+        if (lineEnd == end) return false;
+        const char* word = p;
+        auto keyword = NextWord(word, lineEnd);
+        if (keyword == "format") {
+            format = NextWord(word, lineEnd);
+        } else if (keyword == "element") {
+            PlyElement element;
+            element.name = NextWord(word, lineEnd);
+            if (!ParseWord(word, lineEnd, element.count) || element.count < 0) return false;
+            elements.push_back(std::move(element));
+        } else if (keyword == "property") {
+            if (elements.empty()) return false;
+            auto& element = elements.back();
+            PlyProperty property;
+            auto type = NextWord(word, lineEnd);
+            if (type == "list") {
+                property.countType = ParsePlyType(NextWord(word, lineEnd));
+                if (property.countType == PlyType::NONE || property.countType == PlyType::FLOAT32 || property.countType == PlyType::FLOAT64) return false;
+                type = NextWord(word, lineEnd);
+            }
+            property.type = ParsePlyType(type);
+            if (property.type == PlyType::NONE) return false;
+            auto name = NextWord(word, lineEnd);
+            if (element.name == "vertex" && property.countType == PlyType::NONE)
+                property.target = PlyVertexTarget(name);
+            else if (element.name == "face" && property.countType != PlyType::NONE && (name == "vertex_indices" || name == "vertex_index"))
+                property.target = 0;
+            element.properties.push_back(property);
+        } else if (keyword == "end_header") {
+            p = lineEnd + 1;
+            break;
+        }
+        p = lineEnd + 1;
+    }
+    bool isAscii = format == "ascii", swap = format == (std::endian::native == std::endian::little ? "binary_big_endian" : "binary_little_endian");
+    if (!isAscii && !swap && format != "binary_little_endian" && format != "binary_big_endian")
+        return false;
+
+    auto vertexElement = std::find_if(elements.begin(), elements.end(), [](const PlyElement& element) { return element.name == "vertex"; });
+    if (vertexElement == elements.end()) return false;
+    const int vertexCount = int(vertexElement->count);
+    PlyMesh mesh;
+    for (const auto& property: vertexElement->properties)
+        if (property.target >= 0) mesh.hasTarget[property.target] = true;
+    if (!mesh.hasTarget[0] || !mesh.hasTarget[1] || !mesh.hasTarget[2]) return false;
+    mesh.V = MeshData::Matrix::Zero(vertexCount, 3);
+    mesh.V_normals = MeshData::Matrix::Zero(vertexCount, 3);
+    mesh.V_uv = MeshData::Matrix::Zero(vertexCount, 2);
+
+    MeshData::IndexMatrix F;
+    if (isAscii) {
+        // a record per line, the element of a record follows from the counts of the elements
+        std::vector<std::int64_t> elementEnds;
+        for (const auto& element: elements)
+            elementEnds.push_back((elementEnds.empty() ? 0 : elementEnds.back()) + element.count);
+        auto bounds = ChunkBounds(p, end);
+        std::vector<std::vector<int>> chunkTriangles(bounds.size() - 1), chunkPolygons(bounds.size() - 1);
+        std::atomic<bool> isValid = true;
+        auto recordCount = ParseRecords(bounds, [&](int chunk, std::int64_t record, const char* line, const char* lineEnd) {
+            auto e = int(std::upper_bound(elementEnds.begin(), elementEnds.end(), record) - elementEnds.begin());
+            if (e == int(elements.size()) || (elements[e].name != "vertex" && elements[e].name != "face")) return;
+            auto index = record - (e > 0 ? elementEnds[e - 1] : 0);
+            for (const auto& property: elements[e].properties) {
+                double value;
+                if (property.countType == PlyType::NONE) {
+                    if (!ParseNumber(line, lineEnd, value)) { isValid = false; return; }
+                    if (property.target >= 0 && elements[e].name == "vertex") mesh.SetVertex(index, property.target, value);
+                } else {
+                    int n;
+                    if (!ParseNumber(line, lineEnd, n) || n < 0) { isValid = false; return; }
+                    auto& polygon = chunkPolygons[chunk];
+                    polygon.resize(n);
+                    for (int& v: polygon) {
+                        if (!ParseNumber(line, lineEnd, value)) { isValid = false; return; }
+                        v = int(value);
+                    }
+                    if (property.target == 0) AddPolygon(polygon, vertexCount, chunkTriangles[chunk]);
+                }
+            }
+        });
+        if (!isValid || recordCount < elementEnds.back()) return false;
+        F = GatherFaces(chunkTriangles);
+    } else {
+        // the elements without lists have records of one size, converted in parallel, the others are walked through
+        std::vector<int> triangles, polygon;
+        for (const auto& element: elements) {
+            if (!element.HasLists()) {
+                int stride = element.GetStride();
+                if (std::int64_t(end - p) < element.count * stride) return false;
+                if (element.name == "vertex") {
+                    ThreadPool::Global().ParallelFor(0, vertexCount, 1 << 14, [&, data = p](int vertexBegin, int vertexEnd) {
+                        for (int v = vertexBegin; v < vertexEnd; v++) {
+                            const char* record = data + std::int64_t(v) * stride;
+                            for (const auto& property: element.properties) {
+                                if (property.target >= 0) mesh.SetVertex(v, property.target, ReadPlyValue(record, property.type, swap));
+                                record += PLY_TYPE_SIZES[int(property.type)];
+                            }
+                        }
+                    });
+                }
+                p += element.count * stride;
+                continue;
+            }
+            for (std::int64_t i = 0; i < element.count; i++) {
+                for (const auto& property: element.properties) {
+                    int size = PLY_TYPE_SIZES[int(property.type)];
+                    if (property.countType == PlyType::NONE) {
+                        if (end - p < size) return false;
+                        p += size;
+                        continue;
+                    }
+                    int countSize = PLY_TYPE_SIZES[int(property.countType)];
+                    if (end - p < countSize) return false;
+                    auto n = std::int64_t(ReadPlyValue(p, property.countType, swap));
+                    p += countSize;
+                    if (n < 0 || end - p < n * size) return false;
+                    if (property.target == 0 && element.name == "face") {
+                        polygon.resize(n);
+                        for (int k = 0; k < n; k++)
+                            polygon[k] = int(ReadPlyValue(p + k * size, property.type, swap));
+                        AddPolygon(polygon, vertexCount, triangles);
+                    }
+                    p += n * size;
+                }
+            }
+        }
+        F = Eigen::Map<const MeshData::IndexMatrix>(triangles.data(), std::int64_t(triangles.size() / 3), 3);
+    }
+
+    meshData = {std::move(mesh.V), std::move(F), std::move(mesh.V_normals), std::move(mesh.V_uv)};
+    return true;
+}
+
+bool MeshReader::ReadStl(const std::string& file, MeshData& meshData)
+{
+    MappedFile mappedFile(file);
+    return mappedFile.IsOpen() && ReadStl(mappedFile.GetData(), mappedFile.GetData() + mappedFile.GetSize(), meshData);
+}
+
+bool MeshReader::ReadStl(const char* begin, const char* end, MeshData& meshData)
+{
+    constexpr int HEADER_SIZE = 80 + 4, RECORD_SIZE = 50; // (a record: the normal, the 3 corners and 2 attribute bytes)
+    std::size_t size = end - begin;
+    std::uint32_t triangleCount = 0;
+    if (size >= HEADER_SIZE) std::memcpy(&triangleCount, begin + 80, 4);
+    std::vector<float> corners;
+
+    // binary files are told from ASCII ones by their size (both may start with "solid")
+    if (size >= HEADER_SIZE && size == HEADER_SIZE + std::size_t(triangleCount) * RECORD_SIZE) {
+        corners.resize(std::size_t(triangleCount) * 9);
+        ThreadPool::Global().ParallelFor(0, int(triangleCount), 1 << 14, [&](int triangleBegin, int triangleEnd) {
+            for (int t = triangleBegin; t < triangleEnd; t++)
+                std::memcpy(&corners[std::size_t(t) * 9], begin + HEADER_SIZE + std::size_t(t) * RECORD_SIZE + 12, 9 * sizeof(float));
+        });
+    } else {
+        const char* p = begin;
+        if (NextWord(p, end) != "solid") return false;
+        // the corners are the "vertex x y z" lines, in order
+        auto bounds = ChunkBounds(p, end);
+        std::vector<std::vector<float>> chunkCorners(bounds.size() - 1);
+        ThreadPool::Global().ParallelFor(0, int(bounds.size()) - 1, 1, [&](int chunkBegin, int chunkEnd) {
+            for (int c = chunkBegin; c < chunkEnd; c++)
+                for (const char* line = bounds[c]; line < bounds[c + 1];) {
+                    const char* lineEnd = LineEnd(line, bounds[c + 1]);
+                    const char* word = line;
+                    if (NextWord(word, lineEnd) == "vertex") {
+                        float corner[3]{};
+                        for (float& x: corner)
+                            ParseNumber(word, lineEnd, x);
+                        chunkCorners[c].insert(chunkCorners[c].end(), corner, corner + 3);
+                    }
+                    line = lineEnd + 1;
+                }
+        });
+        for (const auto& moreCorners: chunkCorners)
+            corners.insert(corners.end(), moreCorners.begin(), moreCorners.end());
+        corners.resize(corners.size() / 9 * 9);
+    }
+    if (corners.empty()) return false;
+
+    meshData = WeldTriangles(corners);
+    return true;
+}
+
+template<typename Matrix>
+bool MeshReader::ReadDmat(const std::string& file, Matrix& matrix)
+{
+    MappedFile mappedFile(file);
+    if (!mappedFile.IsOpen()) return false;
+    const char *p = mappedFile.GetData(), *end = p + mappedFile.GetSize();
+
+    // the header is "columns rows", the ASCII entries follow column by column, a header of "0 0" is followed by the binary header and entries
+    auto readHeader = [&p, end](std::int64_t& rows, std::int64_t& cols) {
+        const char* lineEnd = LineEnd(p, end);
+        bool valid = ParseNumber(p, lineEnd, cols) && ParseNumber(p, lineEnd, rows) && rows >= 0 && cols >= 0;
+        p = std::min(lineEnd + 1, end);
+        return valid;
+    };
+    std::int64_t rows, cols;
+    if (!readHeader(rows, cols)) return false;
+
+    if (rows == 0 && cols == 0 && std::any_of(p, end, [](char c) { return !IsSpace(c); })) {
+        if (!readHeader(rows, cols) || std::int64_t(end - p) < rows * cols * std::int64_t(sizeof(double))) return false;
+        matrix.resize(rows, cols);
+        ThreadPool::Global().ParallelFor(0, int(cols), std::max(1, int((1 << 16) / std::max<std::int64_t>(rows, 1))), [&, data = p](int colBegin, int colEnd) {
+            for (int j = colBegin; j < colEnd; j++)
+                for (std::int64_t i = 0; i < rows; i++) {
+                    double value;
+                    std::memcpy(&value, data + (j * rows + i) * std::int64_t(sizeof(double)), sizeof(double)); // (the entries aren't aligned)
+                    matrix(i, j) = typename Matrix::Scalar(value);
+                }
+        });
+        return true;
+    }
+
+    // the ASCII entries, parsed in chunks of lines: the entries of each chunk are counted first, so each is parsed into its place
+    matrix.resize(rows, cols);
+    const std::int64_t entryCount = rows * cols;
+    auto bounds = ChunkBounds(p, end);
+    const int chunkCount = int(bounds.size()) - 1;
+    std::vector<std::int64_t> firstEntries(chunkCount + 1, 0);
+    auto& threadPool = ThreadPool::Global();
+    threadPool.ParallelFor(0, chunkCount, 1, [&](int chunkBegin, int chunkEnd) {
+        for (int c = chunkBegin; c < chunkEnd; c++)
+            for (const char* q = bounds[c]; q < bounds[c + 1]; q++)
+                firstEntries[c + 1] += !IsSpace(*q) && (q == bounds[c] || IsSpace(q[-1]));
+    });
+    for (int c = 0; c < chunkCount; c++)
+        firstEntries[c + 1] += firstEntries[c];
+    if (firstEntries[chunkCount] != entryCount) return false;
+
+    std::atomic<bool> isValid = true;
+    threadPool.ParallelFor(0, chunkCount, 1, [&](int chunkBegin, int chunkEnd) {
+        for (int c = chunkBegin; c < chunkEnd; c++) {
+            std::int64_t entry = firstEntries[c];
+            for (const char* q = bounds[c]; q < bounds[c + 1];) {
+                while (q < bounds[c + 1] && IsSpace(*q)) q++;
+                if (q == bounds[c + 1]) break;
+                double value;
+                if (!ParseNumber(q, bounds[c + 1], value)) {
+                    isValid = false;
+                    return;
+                }
+                matrix(entry % rows, entry / rows) = typename Matrix::Scalar(value);
+                entry++;
+            }
+        }
+    });
+    return isValid;
+}
+
+template<typename Matrix>
+bool MeshReader::WriteDmat(const std::string& file, const Matrix& matrix, bool binary)
+{
+    std::ofstream out(file, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+    const auto rows = std::int64_t(matrix.rows()), cols = std::int64_t(matrix.cols());
+    if (binary) {
+        out << "0 0\n" << cols << " " << rows << "\n";
+        std::vector<double> column(rows);
+        for (std::int64_t j = 0; j < cols; j++) {
+            for (std::int64_t i = 0; i < rows; i++)
+                column[i] = double(matrix(i, j));
+            out.write(reinterpret_cast<const char*>(column.data()), std::streamsize(rows * sizeof(double)));
+        }
+    } else {
+        out << cols << " " << rows << "\n";
+        std::string text;
+        char buffer[32];
+        for (std::int64_t j = 0; j < cols; j++) {
+            text.clear();
+            for (std::int64_t i = 0; i < rows; i++) {
+                auto result = std::to_chars(buffer, buffer + sizeof(buffer), matrix(i, j)); // (shortest text that reads back the same)
+                text.append(buffer, result.ptr);
+                text.push_back('\n');
+            }
+            out << text;
+        }
+    }
+    return bool(out);
+}
+
+template bool MeshReader::ReadDmat(const std::string& file, Eigen::MatrixXf& matrix);
+template bool MeshReader::ReadDmat(const std::string& file, Eigen::MatrixXd& matrix);
+template bool MeshReader::ReadDmat(const std::string& file, MeshData::Matrix& matrix);
+template bool MeshReader::WriteDmat(const std::string& file, const Eigen::MatrixXf& matrix, bool binary);
+template bool MeshReader::WriteDmat(const std::string& file, const Eigen::MatrixXd& matrix, bool binary);
+template bool MeshReader::WriteDmat(const std::string& file, const MeshData::Matrix& matrix, bool binary);
+
+} // namespace cg3d
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "Mesh.h"
+
+
+namespace cg3d
+{
+
+/**
+    Readers of the mesh and matrix files of the tutorial data straight into float buffers (replacing igl::readOFF,
+    igl::readPLY, igl::readSTL and igl::readDMAT, which parse with fscanf into double matrices).
+    Text files are parsed in parallel chunks of lines like ObjParser, binary PLY, STL and DMAT files are converted
+    straight from their memory mapping. Polygons are triangulated as fans, and the separate triangles of STL files are
+    welded on their positions. Missing normals are left zero (so they're computed when drawn), missing texture coordinates too.
+**/
+struct MeshReader
+{
+    // reorder the loaded OFF, PLY and STL meshes for the vertex cache and fetch (see MeshOptimizer), off by default so the
+    // vertices keep the order of the file and match per-vertex files such as the DMAT skinning weights
+    static inline bool optimizeMeshes = false;
+
+    // a mesh file by its extension: .obj (see ObjLoader::MeshDataListFromObjFile), .off, .ply or .stl (empty if it can't be read)
+    // (cached like the OBJ files, see MeshCache)
+    static std::vector<MeshData> MeshDataListFromFile(const std::string& file);
+    static std::shared_ptr<Mesh> MeshFromFile(std::string name, const std::string& file);
+
+    // the readers of each format (false if the text or data isn't a valid mesh of the format)
+    static bool ReadOff(const std::string& file, MeshData& meshData);
+    static bool ReadOff(const char* begin, const char* end, MeshData& meshData);
+    static bool ReadPly(const std::string& file, MeshData& meshData); // (ASCII, binary little and big endian)
+    static bool ReadPly(const char* begin, const char* end, MeshData& meshData);
+    static bool ReadStl(const std::string& file, MeshData& meshData); // (ASCII and binary)
+    static bool ReadStl(const char* begin, const char* end, MeshData& meshData);
+
+    /**
+        @brief Read a dense matrix of a DMAT file (e.g. skinning weights), in the ASCII format or the binary format of igl::writeDMAT
+        @param file   - the file
+        @param matrix - set to the matrix (instantiated for Eigen::MatrixXf, Eigen::MatrixXd and MeshData::Matrix)
+        @retval       - false if the file can't be read or doesn't have the entries its header gives
+    **/
+    template<typename Matrix>
+    static bool ReadDmat(const std::string& file, Matrix& matrix);
+    // write a matrix as DMAT, by default in the binary format (doubles), which is read many times faster than the ASCII one
+    template<typename Matrix>
+    static bool WriteDmat(const std::string& file, const Matrix& matrix, bool binary = true);
+};
+
+} // namespace cg3d
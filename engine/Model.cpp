@@ -3,7 +3,17 @@
 #include "ViewerData.h"
 #include "Movable.h"
 #include "ObjLoader.h"
+#include "Scene.h"
+#include "PoolAllocator.h"
+#include "GLFW/glfw3.h"
+#include "AABB.h"
+#include "edges.h"
+#include "vertex_triangle_adjacency.h"
+#include "ThreadPool.h"
+#include "MeshNormals.h"
 #include <filesystem>
+#include <mutex>
+#include <unordered_map>
 #include <utility>
 
 namespace fs = std::filesystem;
@@ -40,7 +50,13 @@ std::shared_ptr<Model> Model::Create(std::string name, std::shared_ptr<Mesh> mes
 std::shared_ptr<Model>
 Model::Create(std::string name, std::vector<std::shared_ptr<Mesh>> meshList, std::shared_ptr<Material> material, const std::shared_ptr<Movable>& parent)
 {
-    auto model = std::shared_ptr<Model>(new Model(std::move(name), std::move(meshList), std::move(material)));
+    struct PooledModel : Model // makes the protected constructor accessible to allocate_shared
+    {
+        PooledModel(std::string name, std::vector<std::shared_ptr<Mesh>> meshList, std::shared_ptr<Material> material)
+                : Movable(name), Model(std::move(name), std::move(meshList), std::move(material)) {}
+    };
+
+    std::shared_ptr<Model> model = std::allocate_shared<PooledModel>(PoolAllocator<PooledModel>(), std::move(name), std::move(meshList), std::move(material));
     model->SetParent(parent);
     return std::move(model);
 }
@@ -51,52 +67,613 @@ Model::Model(std::string name, std::vector<std::shared_ptr<Mesh>> meshList, std:
     SetMeshList(std::move(meshList));
 }
 
-std::vector<igl::opengl::ViewerData> Model::CreateViewerData(const std::shared_ptr<Mesh>& mesh)
+void Model::SyncWithMeshes()
 {
-    std::vector<igl::opengl::ViewerData> dataList;
+    bool boundsChanged = false;
 
-    for (auto& meshData: mesh->data) {
-        igl::opengl::ViewerData viewerData;
-        viewerData.set_mesh(meshData.vertices, meshData.faces);
-        viewerData.set_uv(meshData.textureCoords);
-        viewerData.set_normals(meshData.vertexNormals);
-        viewerData.line_width = 1.0f;
+    for (int i = 0; i < int(meshList.size()); i++) {
+        auto& sharedData = *sharedDataPerMesh[i];
+        for (int index = 0; index < int(sharedData.viewerDataList.size()) && index < int(meshList[i]->data.size()); index++) {
+            const auto& meshData = meshList[i]->data[index];
+            unsigned int changed = meshData.ChangedSince(sharedData.meshDataVersions[index]);
+            if (changed == MeshData::DIRTY_NONE) continue;
+
+            // a few moved vertices update only the faces around them
+            std::span<const int> editedVertices;
+            if (changed == MeshData::DIRTY_VERTICES && meshData.GetEditedVertices(sharedData.meshDataVersions[index][0], editedVertices) &&
+                sharedData.UpdateVertices(index, editedVertices)) {
+                sharedData.meshDataVersions[index] = meshData.GetVersions();
+                boundsChanged = true;
+                continue;
+            }
+
+            sharedData.Update(index, changed);
+            sharedData.meshDataVersions[index] = meshData.GetVersions();
+            if (changed & MeshData::DIRTY_FACES)
+                sharedData.vertexFaces[index] = {};
+            if (changed & (MeshData::DIRTY_VERTICES | MeshData::DIRTY_FACES)) {
+                sharedData.pickingTrees[index] = {};
+                sharedData.clusters[index] = nullptr;
+                sharedData.bounds.setEmpty();
+                for (auto& data: meshList[i]->data)
+                    for (int v = 0; v < data.GetVertices().rows(); v++)
+                        sharedData.bounds.extend(data.GetVertices().row(v).transpose());
+                boundsChanged = true;
+            }
+        }
+    }
+
+    if (boundsChanged)
+        UpdateSpatialIndex(); // (other models showing the meshes are updated when they move)
+}
+
+Model::SharedMeshData::SharedMeshData(const SharedMeshData& other) : mesh(other.mesh), viewerDataList(other.viewerDataList), bounds(other.bounds),
+        meshDataVersions(other.meshDataVersions), attributes(other.attributes), pickingTrees(other.viewerDataList.size()), clusters(other.clusters),
+        vertexFaces(other.vertexFaces), editedDirectly(other.editedDirectly)
+{
+    for (auto& viewerData: viewerDataList) { // note: the trees aren't copied, the copy is about to be edited anyway
+        auto vertexFormat = viewerData.meshgl.vertex_format;
+        viewerData.meshgl = igl::opengl::MeshGL(); // don't share the GPU handles of the original
+        viewerData.meshgl.vertex_format = vertexFormat;
+        viewerData.dirty = igl::opengl::MeshGL::DIRTY_ALL;
+    }
+}
+
+Model::SharedMeshData::~SharedMeshData()
+{
+    if (!glfwGetCurrentContext()) return; // the context (and everything in it) is already gone
+
+    for (auto& viewerData: viewerDataList) {
+        viewerData.meshgl.shader_mesh = 0; // the program is owned by the material, not by the mesh
+        viewerData.meshgl.free();
+    }
+}
+
+const MeshData* Model::SharedMeshData::GetSource(int index) const
+{
+    return editedDirectly || index >= int(mesh->data.size()) ? nullptr : &mesh->data[index];
+}
+
+void Model::SharedMeshData::Update(int index, unsigned int parts)
+{
+    using igl::opengl::MeshGL;
+    const auto& meshData = mesh->data[index];
+    const auto& V = meshData.GetVertices();
+    const auto& F = meshData.GetFaces();
+    auto& viewerData = viewerDataList[index];
+    auto& attribute = attributes[index];
+
+    if (parts & MeshData::DIRTY_FACES) {
+        viewerData.F = F;
+        viewerData.dirty |= MeshGL::DIRTY_FACE | MeshGL::DIRTY_POSITION | MeshGL::DIRTY_AMBIENT | MeshGL::DIRTY_DIFFUSE | MeshGL::DIRTY_SPECULAR;
+        parts = MeshData::DIRTY_ALL;
+    } else if (parts & MeshData::DIRTY_VERTICES) {
+        viewerData.dirty |= MeshGL::DIRTY_POSITION;
+    }
+
+    if (parts & MeshData::DIRTY_TEXTURE_COORDS) {
+        attribute.gridTextureCoords.resize(0, 2);
+        if (meshData.GetTextureCoords().rows() != V.rows() && !editedDirectly) {
+            // igl makes the grid (and its texture) from double precision vertices, which are kept only while it does
+            viewerData.V = V.cast<double>();
+            viewerData.V_uv.resize(0, 2);
+            viewerData.grid_texture();
+            attribute.gridTextureCoords = viewerData.V_uv.cast<float>();
+            viewerData.V.resize(0, 3);
+            viewerData.V_uv.resize(0, 2);
+        }
+        viewerData.dirty |= MeshGL::DIRTY_UV;
+    }
+
+    if (parts & (MeshData::DIRTY_NORMALS | MeshData::DIRTY_VERTICES)) {
+        // use the normals of the mesh data unless they're missing or the vertices moved without them,
+        // computing the ones that are missing (zero) for some of the vertices only
+        const auto& normals = meshData.GetVertexNormals();
+        std::vector<int> missing;
+        bool hasNormals = (parts & MeshData::DIRTY_NORMALS) && normals.rows() == V.rows() && normals.size() > 0;
+        for (int v = 0; hasNormals && v < normals.rows(); v++)
+            if (normals.row(v).isZero(0))
+                missing.push_back(v);
+        hasNormals = hasNormals && missing.size() < std::size_t(normals.rows());
+
+        MeshNormals::PerFace(V, F, attribute.faceNormals);
+        if (hasNormals) {
+            attribute.vertexNormals.resize(0, 3);
+            if (!missing.empty()) {
+                MeshData::Matrix computed;
+                MeshNormals::PerVertex(V, F, attribute.faceNormals, computed);
+                attribute.vertexNormals = normals;
+                for (int v: missing)
+                    attribute.vertexNormals.row(v) = computed.row(v);
+            }
+        } else {
+            MeshNormals::PerVertex(V, F, attribute.faceNormals, attribute.vertexNormals);
+        }
+        viewerData.dirty |= MeshGL::DIRTY_NORMAL;
+    }
+
+    if (editedDirectly)
+        FillViewerData(index, parts);
+}
+
+void Model::SharedMeshData::FillViewerData(int index, unsigned int parts)
+{
+    const auto& meshData = mesh->data[index];
+    auto& viewerData = viewerDataList[index];
+    const auto& attribute = attributes[index];
+
+    if (parts & MeshData::DIRTY_FACES) {
+        // (not set_mesh, which computes the normals and loads a default texture the first time)
+        viewerData.V = meshData.GetVertices().cast<double>();
+        viewerData.F = meshData.GetFaces();
+        viewerData.dirty |= igl::opengl::MeshGL::DIRTY_FACE | igl::opengl::MeshGL::DIRTY_POSITION;
         viewerData.uniform_colors(Eigen::Vector3d(1.0, 1.0, 1.0), Eigen::Vector3d(1.0, 1.0, 1.0), Eigen::Vector3d(1.0, 1.0, 1.0)); // todo: implement colors
-        viewerData.compute_normals(); // todo: implement (this overwrites both face and vertex normals even if either is already present)
-        if (viewerData.V_uv.rows() == 0)
+        parts = MeshData::DIRTY_ALL;
+    } else if (parts & MeshData::DIRTY_VERTICES) {
+        viewerData.set_vertices(meshData.GetVertices().cast<double>());
+    }
+
+    if (parts & MeshData::DIRTY_TEXTURE_COORDS) {
+        if (meshData.GetTextureCoords().rows() == viewerData.V.rows()) {
+            viewerData.set_uv(meshData.GetTextureCoords().cast<double>());
+        } else {
+            viewerData.V_uv.resize(0, 2);
             viewerData.grid_texture();
+        }
+    }
+
+    if (parts & (MeshData::DIRTY_NORMALS | MeshData::DIRTY_VERTICES)) {
+        const auto& normals = attribute.vertexNormals.rows() > 0 ? attribute.vertexNormals : meshData.GetVertexNormals();
+        viewerData.F_normals = attribute.faceNormals.cast<double>();
+        viewerData.set_normals(normals.cast<double>());
+        viewerData.dirty |= igl::opengl::MeshGL::DIRTY_NORMAL;
+    }
+}
+
+void Model::SharedMeshData::UpdateAndBindMesh(int index, const Program& program)
+{
+    using igl::opengl::MeshGL;
+    auto& viewerData = viewerDataList[index];
+    const MeshData* meshData = GetSource(index);
+    if (!meshData) {
+        UpdateDataAndBindMesh(viewerData, program);
+        return;
+    }
+
+    // fill the vertex buffers from the float data with one buffer row per vertex, updateGL takes the faces and the texture
+    auto& meshgl = viewerData.meshgl;
+    const auto& attribute = attributes[index];
+    const auto& V = meshData->GetVertices();
+    meshgl.dirty |= viewerData.dirty;
+    viewerData.dirty = MeshGL::DIRTY_NONE;
+    if (meshgl.dirty & MeshGL::DIRTY_POSITION)
+        meshgl.V_vbo = V;
+    if (meshgl.dirty & MeshGL::DIRTY_NORMAL) {
+        meshgl.V_normals_vbo = attribute.vertexNormals.rows() > 0 ? attribute.vertexNormals : meshData->GetVertexNormals();
+        if (viewerData.invert_normals)
+            meshgl.V_normals_vbo = -meshgl.V_normals_vbo;
+    }
+    if (meshgl.dirty & MeshGL::DIRTY_UV)
+        meshgl.V_uv_vbo = attribute.gridTextureCoords.rows() > 0 ? attribute.gridTextureCoords : meshData->GetTextureCoords();
+    if (meshgl.dirty & MeshGL::DIRTY_AMBIENT)
+        meshgl.V_ambient_vbo = MeshGL::RowMatrixXf::Ones(V.rows(), 4); // todo: implement colors
+    if (meshgl.dirty & MeshGL::DIRTY_DIFFUSE)
+        meshgl.V_diffuse_vbo = MeshGL::RowMatrixXf::Ones(V.rows(), 4);
+    if (meshgl.dirty & MeshGL::DIRTY_SPECULAR)
+        meshgl.V_specular_vbo = MeshGL::RowMatrixXf::Ones(V.rows(), 4);
+
+    unsigned int filled = meshgl.dirty & (MeshGL::DIRTY_POSITION | MeshGL::DIRTY_NORMAL | MeshGL::DIRTY_UV |
+                                          MeshGL::DIRTY_AMBIENT | MeshGL::DIRTY_DIFFUSE | MeshGL::DIRTY_SPECULAR);
+    meshgl.dirty &= ~filled;
+    viewerData.updateGL(viewerData, viewerData.invert_normals, meshgl);
+    meshgl.dirty |= filled; // (uploaded by bind_mesh)
+    meshgl.shader_mesh = program.GetHandle();
+    meshgl.bind_mesh();
+}
+
+const Eigen::MatrixXd& Model::SharedMeshData::GetPickingVertices(int index)
+{
+    auto& V = pickingTrees[index].V;
+    if (V.rows() == 0) {
+        if (const MeshData* meshData = GetSource(index))
+            V = meshData->GetVertices().cast<double>();
+        else
+            V = viewerDataList[index].V;
+    }
+    return V;
+}
+
+const igl::AABB<Eigen::MatrixXd, 3>& Model::SharedMeshData::GetTree(int index, PrimitiveType type)
+{
+    auto& tree = pickingTrees[index].trees[int(type)];
+    if (!tree) {
+        const auto& V = GetPickingVertices(index);
+        auto& elements = pickingTrees[index].elements[int(type)];
+        if (type == PrimitiveType::Vertex)
+            elements = Eigen::VectorXi::LinSpaced(V.rows(), 0, int(V.rows() - 1));
+        else if (type == PrimitiveType::Edge)
+            igl::edges(viewerDataList[index].F, elements);
+        tree = std::make_shared<igl::AABB<Eigen::MatrixXd, 3>>();
+        tree->init(V, GetElements(index, type));
+    }
+    return *tree;
+}
+
+const Eigen::MatrixXi& Model::SharedMeshData::GetElements(int index, PrimitiveType type) const
+{
+    return type == PrimitiveType::Face ? viewerDataList[index].F : pickingTrees[index].elements[int(type)];
+}
+
+const MeshClusters* Model::SharedMeshData::GetClusters(int index)
+{
+    const auto& viewerData = viewerDataList[index];
+    if (viewerData.F.rows() < MeshClusters::MIN_MESH_FACES) return nullptr;
+    if (!clusters[index]) {
+        if (const MeshData* meshData = GetSource(index))
+            clusters[index] = std::make_shared<MeshClusters>(meshData->GetVertices(), meshData->GetFaces());
+        else
+            clusters[index] = std::make_shared<MeshClusters>(MeshData::Matrix(viewerData.V.cast<float>()), MeshData::IndexMatrix(viewerData.F));
+    }
+    return clusters[index].get();
+}
+
+bool Model::SharedMeshData::UpdateVertices(int index, std::span<const int> vertices)
+{
+    const MeshData* meshData = GetSource(index);
+    if (!meshData) return false; // (the viewer data is edited directly)
+    auto& viewerData = viewerDataList[index];
+    auto& attribute = attributes[index];
+    const auto& V = meshData->GetVertices();
+    const auto& F = meshData->GetFaces();
+    if (attribute.faceNormals.rows() != F.rows() || viewerData.F.rows() != F.rows())
+        return false;
+    if (attribute.vertexNormals.rows() == 0) // (the normals of the mesh data were used as they are)
+        attribute.vertexNormals = meshData->GetVertexNormals();
+    if (attribute.vertexNormals.rows() != V.rows())
+        return false;
+
+    auto& adjacency = vertexFaces[index];
+    if (adjacency.offsets.size() == 0)
+        igl::vertex_triangle_adjacency(viewerData.F, int(V.rows()), adjacency.faces, adjacency.offsets);
+
+    std::vector<int> moved(vertices.begin(), vertices.end()), faces, touched; // touched: the vertices whose normals change
+    std::sort(moved.begin(), moved.end());
+    moved.erase(std::unique(moved.begin(), moved.end()), moved.end());
+    for (int v: moved) {
+        bounds.extend(V.row(v).transpose()); // (may stay larger than needed until the next full update)
+        for (int i = adjacency.offsets(v); i < adjacency.offsets(v + 1); i++)
+            faces.push_back(adjacency.faces(i));
+    }
+    std::sort(faces.begin(), faces.end());
+    faces.erase(std::unique(faces.begin(), faces.end()), faces.end());
+    touched = moved;
+    for (int f: faces)
+        for (int j = 0; j < 3; j++)
+            touched.push_back(F(f, j));
+    std::sort(touched.begin(), touched.end());
+    touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+
+    MeshNormals::UpdatePerFace(V, F, faces, attribute.faceNormals);
+    MeshNormals::UpdatePerVertex(V, F, attribute.faceNormals, adjacency.faces, adjacency.offsets, touched, attribute.vertexNormals);
+
+    // patch the copies of the GPU buffers and upload just the touched rows (or everything if a full upload is pending anyway)
+    auto& meshgl = viewerData.meshgl;
+    bool pendingUpload = (viewerData.dirty | meshgl.dirty) & (igl::opengl::MeshGL::DIRTY_POSITION | igl::opengl::MeshGL::DIRTY_NORMAL);
+    if (meshgl.is_initialized && !pendingUpload && meshgl.V_vbo.rows() == V.rows() && meshgl.V_normals_vbo.rows() == V.rows()) {
+        float sign = viewerData.invert_normals ? -1.0f : 1.0f;
+        for (int v: touched) {
+            meshgl.V_vbo.row(v) = V.row(v);
+            meshgl.V_normals_vbo.row(v) = sign * attribute.vertexNormals.row(v);
+        }
+        meshgl.dirty_rows.insert(meshgl.dirty_rows.end(), touched.begin(), touched.end());
+    } else {
+        viewerData.dirty |= igl::opengl::MeshGL::DIRTY_POSITION | igl::opengl::MeshGL::DIRTY_NORMAL;
+    }
+
+    pickingTrees[index] = {};
+    if (clusters[index]) {
+        if (clusters[index].use_count() > 1) // (shared with a copy of the data)
+            clusters[index] = std::make_shared<MeshClusters>(*clusters[index]);
+        clusters[index]->Refit(V, F, faces);
+    }
+
+    return true;
+}
+
+igl::opengl::ViewerData& Model::EditViewerData(int mesh, int index)
+{
+    auto& sharedData = sharedDataPerMesh[mesh];
+    if (sharedData.use_count() > 1)
+        sharedData = std::make_shared<SharedMeshData>(*sharedData);
+    sharedData->pickingTrees.assign(sharedData->viewerDataList.size(), {}); // the geometry may change
+    sharedData->clusters.assign(sharedData->viewerDataList.size(), nullptr);
+    sharedData->vertexFaces.assign(sharedData->viewerDataList.size(), {});
+    if (!sharedData->editedDirectly) { // fill in the geometry the GPU buffers took from the mesh data so far
+        sharedData->editedDirectly = true;
+        for (int i = 0; i < int(sharedData->viewerDataList.size()) && i < int(sharedData->mesh->data.size()); i++)
+            sharedData->FillViewerData(i, MeshData::DIRTY_ALL);
+    }
+    return sharedData->viewerDataList[index];
+}
+
+bool Model::IntersectRay(const Eigen::Matrix4f& transform, const Eigen::Vector3f& origin, const Eigen::Vector3f& direction, RayHit& hit)
+{
+    // move the ray into the model space instead of transforming the mesh (an affine map keeps the ray parameter t)
+    Eigen::Matrix4f inverse = transform.inverse();
+    Eigen::RowVector3d localOrigin = (inverse.block<3, 3>(0, 0) * origin + inverse.block<3, 1>(0, 3)).transpose().cast<double>();
+    Eigen::RowVector3d localDirection = (inverse.block<3, 3>(0, 0) * direction).transpose().cast<double>();
+
+    bool updated = false;
+    for (int mesh = 0; mesh < int(sharedDataPerMesh.size()); mesh++) {
+        auto& sharedData = *sharedDataPerMesh[mesh];
+        int index = std::min(meshIndex, int(sharedData.viewerDataList.size() - 1));
+        auto& viewerData = sharedData.viewerDataList[index];
+        if (viewerData.F.rows() == 0) continue;
+
+        igl::Hit meshHit{};
+        const auto& tree = sharedData.GetTree(index, PrimitiveType::Face);
+        if (tree.intersect_ray(sharedData.GetPickingVertices(index), viewerData.F, localOrigin, localDirection, meshHit) && meshHit.t < hit.t) {
+            hit.model = this;
+            hit.mesh = mesh;
+            hit.index = index;
+            hit.face = meshHit.id;
+            hit.barycentric = {1 - meshHit.u - meshHit.v, meshHit.u, meshHit.v};
+            hit.t = meshHit.t;
+            hit.position = origin + hit.t * direction;
+            hit.localPosition = (localOrigin + meshHit.t * localDirection).transpose().cast<float>();
+            updated = true;
+        }
+    }
+
+    return updated;
+}
+
+PrimitiveHit Model::SnapToPrimitive(const RayHit& hit, PrimitiveType type, const Eigen::Matrix4f& transform)
+{
+    PrimitiveHit primitiveHit{hit, type, hit.face};
+    primitiveHit.localPosition = hit.localPosition;
+    primitiveHit.position = hit.position;
+    if (hit.model != this || type == PrimitiveType::Face) return primitiveHit;
+
+    auto& sharedData = *sharedDataPerMesh[hit.mesh];
+    const auto& tree = sharedData.GetTree(hit.index, type);
+    const auto& elements = sharedData.GetElements(hit.index, type);
+
+    int element;
+    Eigen::RowVector3d closest;
+    tree.squared_distance(sharedData.GetPickingVertices(hit.index), elements, hit.localPosition.transpose().cast<double>(), std::numeric_limits<double>::infinity(), element, closest);
+    if (element < 0) return primitiveHit;
+
+    if (type == PrimitiveType::Vertex)
+        primitiveHit.vertex = element;
+    else
+        primitiveHit.edge = elements.row(element).transpose();
+    primitiveHit.localPosition = closest.transpose().cast<float>();
+    primitiveHit.position = transform.block<3, 3>(0, 0) * primitiveHit.localPosition + transform.block<3, 1>(0, 3);
+
+    return primitiveHit;
+}
+
+std::vector<int> Model::SelectPrimitives(const ScreenRegion& region, const Eigen::Matrix4f& clipMatrix, PrimitiveType type, int mesh)
+{
+    if (type == PrimitiveType::Edge) type = PrimitiveType::Face;
+
+    auto& sharedData = *sharedDataPerMesh[mesh];
+    int index = std::min(meshIndex, int(sharedData.viewerDataList.size() - 1));
+    auto& viewerData = sharedData.viewerDataList[index];
+    const auto& tree = sharedData.GetTree(index, type);
+    const Eigen::MatrixXd& V = sharedData.GetPickingVertices(index);
+    const Eigen::MatrixXi& F = viewerData.F;
+
+    // the planes of the frustum of the region bounds in the model space (inside when n.p + d >= 0)
+    Eigen::Matrix4d frustum = (region.PickMatrix() * clipMatrix).cast<double>();
+    Eigen::Matrix<double, 4, 6> planes;
+    for (int i = 0; i < 3; i++) {
+        planes.col(2 * i) = (frustum.row(3) + frustum.row(i)).transpose();
+        planes.col(2 * i + 1) = (frustum.row(3) - frustum.row(i)).transpose();
+    }
+
+    std::vector<int> selected;
+    auto addLeaves = [&selected](const igl::AABB<Eigen::MatrixXd, 3>* node) {
+        std::vector<const igl::AABB<Eigen::MatrixXd, 3>*> stack{node};
+        while (!stack.empty()) {
+            node = stack.back();
+            stack.pop_back();
+            if (node->m_primitive != -1) {
+                selected.push_back(node->m_primitive);
+            } else {
+                stack.push_back(node->m_left);
+                stack.push_back(node->m_right);
+            }
+        }
+    };
+
+    std::vector<const igl::AABB<Eigen::MatrixXd, 3>*> stack{&tree};
+    while (!stack.empty()) {
+        auto node = stack.back();
+        stack.pop_back();
+        if (node->m_box.isEmpty()) continue; // (an empty mesh)
+
+        bool fullyInside = true;
+        bool outside = false;
+        for (int i = 0; i < 6 && !outside; i++) {
+            auto normal = planes.col(i).head<3>();
+            Eigen::Vector3d farCorner = (normal.array() >= 0).select(node->m_box.max(), node->m_box.min());
+            Eigen::Vector3d nearCorner = (normal.array() >= 0).select(node->m_box.min(), node->m_box.max());
+            outside = normal.dot(farCorner) + planes(3, i) < 0;
+            fullyInside = fullyInside && normal.dot(nearCorner) + planes(3, i) >= 0;
+        }
+        if (outside) continue;
+
+        if (fullyInside && region.IsRect()) { // everything in the node is inside the rectangle
+            addLeaves(node);
+        } else if (node->m_primitive != -1) {
+            int primitive = node->m_primitive;
+            Eigen::Vector3d point = type == PrimitiveType::Vertex ? Eigen::Vector3d(V.row(primitive)) :
+                                    Eigen::Vector3d((V.row(F(primitive, 0)) + V.row(F(primitive, 1)) + V.row(F(primitive, 2))) / 3);
+            if (region.ContainsProjected(clipMatrix * point.cast<float>().homogeneous()))
+                selected.push_back(primitive);
+        } else {
+            stack.push_back(node->m_left);
+            stack.push_back(node->m_right);
+        }
+    }
+
+    return selected;
+}
+
+void Model::SetVertexFormat(unsigned int format)
+{
+    for (auto& sharedData: sharedDataPerMesh)
+        for (auto& viewerData: sharedData->viewerDataList)
+            viewerData.meshgl.vertex_format = format; // (the buffers are uploaded again on the next draw)
+}
+
+void Model::PreparePicking()
+{
+    std::vector<std::pair<SharedMeshData*, int>> tasks; // one per tree
+    for (auto& sharedData: sharedDataPerMesh) {
+        if (std::any_of(tasks.begin(), tasks.end(), [&sharedData](const auto& task) { return task.first == sharedData.get(); }))
+            continue; // the same mesh appears twice
+        sharedData->pickingTrees.resize(sharedData->viewerDataList.size());
+        for (int index = 0; index < int(sharedData->viewerDataList.size()); index++) {
+            sharedData->GetPickingVertices(index); // (shared by the trees)
+            for (int type = 0; type < 3; type++)
+                tasks.emplace_back(sharedData.get(), index * 3 + type);
+        }
+    }
+
+    ThreadPool::Global().ParallelFor(0, int(tasks.size()), 1, [&tasks](int begin, int end) {
+        for (int i = begin; i < end; i++)
+            tasks[i].first->GetTree(tasks[i].second / 3, PrimitiveType(tasks[i].second % 3));
+    });
+}
+
+std::shared_ptr<Model::SharedMeshData> Model::GetSharedMeshData(const std::shared_ptr<Mesh>& mesh)
+{
+    // the cache only keeps the data alive while there are models using it (the mesh is kept to detect reused addresses)
+    static std::mutex mutex;
+    static std::unordered_map<const Mesh*, std::pair<std::weak_ptr<Mesh>, std::weak_ptr<SharedMeshData>>> cache;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& [cachedMesh, cachedData] = cache[mesh.get()];
+    if (auto sharedData = cachedData.lock(); sharedData && cachedMesh.lock() == mesh)
+        return sharedData;
+
+    auto sharedData = std::make_shared<SharedMeshData>();
+    sharedData->mesh = mesh;
+    sharedData->viewerDataList.resize(mesh->data.size());
+    sharedData->attributes.resize(mesh->data.size());
+    sharedData->pickingTrees.resize(mesh->data.size());
+    sharedData->clusters.resize(mesh->data.size());
+    sharedData->vertexFaces.resize(mesh->data.size());
+    for (int index = 0; index < int(mesh->data.size()); index++) {
+        auto& viewerData = sharedData->viewerDataList[index];
+        viewerData.line_width = 1.0f;
         viewerData.is_visible = 1;
         viewerData.show_overlay = 0;
-        dataList.emplace_back(std::move(viewerData));
+        sharedData->Update(index, MeshData::DIRTY_ALL);
+        sharedData->GetClusters(index); // (split large meshes up front rather than on the first draw)
+    }
+    for (auto& meshData: mesh->data) {
+        sharedData->meshDataVersions.push_back(meshData.GetVersions());
+        for (int i = 0; i < meshData.GetVertices().rows(); i++)
+            sharedData->bounds.extend(meshData.GetVertices().row(i).transpose());
     }
 
-    return dataList;
+    cachedMesh = mesh;
+    cachedData = sharedData;
+
+    if (cache.size() > 64 && (cache.size() & (cache.size() - 1)) == 0) // prune the expired entries once in a while
+        for (auto it = cache.begin(); it != cache.end();)
+            it = it->second.second.expired() ? cache.erase(it) : std::next(it);
+
+    return sharedData;
 }
 
 void Model::UpdateDataAndBindMesh(igl::opengl::ViewerData& viewerData, const Program& program)
 {
+    viewerData.updateGL(viewerData, viewerData.invert_normals, viewerData.meshgl); // (passes the changes to the GPU buffers)
     viewerData.dirty = igl::opengl::MeshGL::DIRTY_NONE;
-    viewerData.updateGL(viewerData, viewerData.invert_normals, viewerData.meshgl);
     viewerData.meshgl.shader_mesh = program.GetHandle();
     viewerData.meshgl.bind_mesh();
 }
 
-void Model::UpdateDataAndDrawMeshes(const Program& program, bool _showFaces, bool bindTextures)
+void Model::UpdateDataAndDrawMeshes(const Program& program, bool _showFaces, bool bindTextures, const MeshClusters::View* view)
 {
-    for (auto& viewerDataList: viewerDataListPerMesh) {
-        auto& viewerData = viewerDataList[std::min(meshIndex, int(viewerDataList.size() - 1))];
-        UpdateDataAndBindMesh(viewerData, program);
+    SyncWithMeshes();
+
+    static std::vector<int> counts; // (drawing happens on the main thread only)
+    static std::vector<const void*> offsets;
+    for (int i = 0; i < int(sharedDataPerMesh.size()); i++) {
+        auto& sharedData = sharedDataPerMesh[i];
+        auto& viewerDataList = sharedData->viewerDataList;
+        int index = std::min(meshIndex, int(viewerDataList.size() - 1));
+        auto& viewerData = viewerDataList[index];
+        sharedData->UpdateAndBindMesh(index, program);
         if (bindTextures) material->BindTextures();
-        viewerData.meshgl.draw_mesh(_showFaces);
+        const MeshClusters* clusters = view ? sharedData->GetClusters(index) : nullptr;
+        if (clusters) {
+            clusters->Cull(*view, counts, offsets);
+            viewerData.meshgl.draw_mesh_ranges(_showFaces, counts.data(), offsets.data(), int(counts.size()));
+        } else {
+            viewerData.meshgl.draw_mesh(_showFaces);
+        }
     }
 }
 
 void Model::SetMeshList(std::vector<std::shared_ptr<Mesh>> _meshList)
 {
     meshList = std::move(_meshList);
-    viewerDataListPerMesh.clear();
+    sharedDataPerMesh.clear();
     for (auto& mesh: meshList)
-        viewerDataListPerMesh.emplace_back(CreateViewerData(mesh));
+        sharedDataPerMesh.emplace_back(GetSharedMeshData(mesh));
+
+    UpdateSpatialIndex();
+}
+
+Eigen::AlignedBox3f Model::GetBounds() const
+{
+    Eigen::AlignedBox3f bounds;
+    for (auto& sharedData: sharedDataPerMesh)
+        bounds.extend(sharedData->bounds);
+    return bounds;
+}
+
+Eigen::AlignedBox3f Model::GetWorldBounds() const
+{
+    auto bounds = GetBounds();
+    if (bounds.isEmpty()) return bounds;
+
+    Eigen::Matrix3f linear = aggregatedTransform.block<3, 3>(0, 0);
+    Eigen::Vector3f center = linear * bounds.center() + aggregatedTransform.block<3, 1>(0, 3);
+    Eigen::Vector3f extent = linear.cwiseAbs() * (bounds.sizes() / 2);
+    return {center - extent, center + extent};
+}
+
+void Model::PropagateTransform()
+{
+    Movable::PropagateTransform();
+    UpdateSpatialIndex();
+}
+
+void Model::UpdateSpatialIndex()
+{
+    // find the scene at the root of the hierarchy (if any)
+    std::shared_ptr<Movable> root;
+    for (auto p = parent.lock(); p; p = p->parent.lock())
+        root = p;
+    auto scene = std::dynamic_pointer_cast<Scene>(root);
+
+    if (!scene || GetBounds().isEmpty()) {
+        spatialProxy.Reset();
+        return;
+    }
+
+    if (spatialProxy.tree.lock() != scene->spatialIndex)
+        spatialProxy = AabbTree::Proxy(scene->spatialIndex, scene->spatialIndex->Insert(GetWorldBounds(), this));
+    else
+        scene->spatialIndex->Move(spatialProxy.id, GetWorldBounds());
 }
 
 void Model::Accept(Visitor* visitor)
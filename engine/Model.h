@@ -1,15 +1,53 @@
 #pragma once
 
 #include <iostream>
+#include <limits>
 #include "Mesh.h"
 #include "Material.h"
 #include "Movable.h"
 #include "ViewerData.h"
+#include "AabbTree.h"
+#include "ScreenRegion.h"
+#include "MeshClusters.h"
 
 
+namespace igl { template<typename DerivedV, int DIM> class AABB; }
+
 namespace cg3d
 {
 
+class Model;
+
+// result of intersecting a ray with models (see Model::IntersectRay and Scene::PickRay)
+struct RayHit
+{
+    Model* model = nullptr;
+    int mesh = -1; // index in the mesh list of the model
+    int index = -1; // index in the data list of the mesh (see Model::meshIndex)
+    int face = -1;
+    Eigen::Vector3f barycentric{0, 0, 0}; // weights of the 3 vertices of the face
+    Eigen::Vector3f position{0, 0, 0}; // the hit point (in the space of the ray)
+    Eigen::Vector3f localPosition{0, 0, 0}; // the hit point in the model space
+    float t = std::numeric_limits<float>::infinity(); // the hit point is origin + t * direction
+    float depth = 1; // window depth of the hit point (same as the depth buffer value)
+};
+
+enum class PrimitiveType
+{
+    Face, Vertex, Edge
+};
+
+// a ray hit snapped to a mesh primitive (see Model::SnapToPrimitive and Scene::PickPrimitive)
+struct PrimitiveHit
+{
+    RayHit hit;
+    PrimitiveType type = PrimitiveType::Face;
+    int face = -1, vertex = -1;
+    Eigen::Vector2i edge{-1, -1}; // the vertices of the edge
+    Eigen::Vector3f localPosition{0, 0, 0}; // the snapped point (the vertex, the closest point on the edge or the hit point)
+    Eigen::Vector3f position{0, 0, 0}; // the snapped point in the space of the ray
+};
+
 class Model : virtual public Movable
 {
     friend class DrawVisitor;
@@ -32,22 +70,118 @@ public:
     bool isHidden = false;
     Eigen::Vector4f wireframeColor{0, 0, 0, 0};
     int meshIndex = 0;
+    bool cullClusters = true; // draw only the clusters of large meshes that are in the view frustum (see MeshClusters)
+    bool cullBackClusters = false; // also skip clusters facing away from the camera (for closed meshes)
 
     inline const std::vector<std::shared_ptr<Mesh>>& GetMeshList() const { return meshList; }
     void SetMeshList(std::vector<std::shared_ptr<Mesh>> _meshList);
 
+    // copies of a model share the viewer data of its meshes, editing it first makes a private copy (copy on write);
+    // the viewer data of meshes drawn from their mesh data holds only the faces, editing it fills in the rest
+    [[nodiscard]] inline const igl::opengl::ViewerData& GetViewerData(int mesh = 0, int index = 0) const { return sharedDataPerMesh[mesh]->viewerDataList[index]; }
+    igl::opengl::ViewerData& EditViewerData(int mesh = 0, int index = 0);
+    [[nodiscard]] inline long GetViewerDataUseCount(int mesh = 0) const { return sharedDataPerMesh[mesh].use_count(); }
+
+    /**
+        @brief Intersect a ray with the meshes of the model (as they are drawn, see meshIndex) using per mesh AABB trees
+        @param transform - the transformation of the model into the space of the ray
+        @param origin    - origin of the ray
+        @param direction - direction of the ray (doesn't have to be normalized)
+        @param hit       - updated only if the ray hits the model closer than hit.t
+        @retval          - true if hit was updated
+    **/
+    bool IntersectRay(const Eigen::Matrix4f& transform, const Eigen::Vector3f& origin, const Eigen::Vector3f& direction, RayHit& hit);
+
+    /**
+        @brief Snap a ray hit on the model to the closest vertex or edge of the mesh that was hit (using AABB trees of the vertices and edges)
+        @param hit       - a hit returned by IntersectRay
+        @param type      - the type of the primitive to snap to
+        @param transform - the transformation that was given to IntersectRay
+    **/
+    PrimitiveHit SnapToPrimitive(const RayHit& hit, PrimitiveType type, const Eigen::Matrix4f& transform);
+
+    /**
+        @brief Find the vertices or faces (by their centers) of a mesh that are projected inside a screen region,
+        pruning the picking tree of the mesh with the frustum of the region bounds (occluded primitives are included)
+        @param region     - the region in the normalized device coordinates of the viewport
+        @param clipMatrix - the transformation from the model space to clip coordinates (proj * view * model)
+        @param type       - vertices or faces (edges are treated as faces)
+        @param mesh       - index in the mesh list
+        @retval           - indices of the primitives
+    **/
+    std::vector<int> SelectPrimitives(const ScreenRegion& region, const Eigen::Matrix4f& clipMatrix, PrimitiveType type, int mesh = 0);
+
+    // the format of the vertex buffers of the meshes (igl::opengl::MeshGL::VertexFormat flags, e.g. FORMAT_COMPACT),
+    // shared with the other models showing the same meshes
+    void SetVertexFormat(unsigned int format);
+    void PreparePicking(); // build the picking trees of all the meshes in parallel (instead of on the first pick)
+    Eigen::AlignedBox3f GetBounds() const; // bounding box of all the meshes (in model space)
+    Eigen::AlignedBox3f GetWorldBounds() const; // bounding box of the transformed bounds (in the space of aggregatedTransform)
+    void PropagateTransform() override;
+
     // helper functions
     static void UpdateDataAndBindMesh(igl::opengl::ViewerData& viewerData, const Program& program);
-    void UpdateDataAndDrawMeshes(const Program& program, bool _showFaces, bool bindTextures);
+    void UpdateDataAndDrawMeshes(const Program& program, bool _showFaces, bool bindTextures, const MeshClusters::View* view = nullptr);
 
 protected:
     // protected constructor (use factory method to create models)
     Model(std::string name, std::vector<std::shared_ptr<Mesh>> meshList, std::shared_ptr<Material> material = nullptr);
 
 private:
-    static std::vector<igl::opengl::ViewerData> CreateViewerData(const std::shared_ptr<Mesh>& mesh);
+    // the viewer data (and therefore the GPU buffers) of a mesh, shared by all the models showing the mesh and their copies
+    struct SharedMeshData
+    {
+        std::shared_ptr<const Mesh> mesh;
+        // the viewer data keeps only the faces, the GPU buffers are filled from the (float) mesh data and the attributes
+        // below instead of double precision copies, unless the viewer data is edited directly (see FillViewerData)
+        std::vector<igl::opengl::ViewerData> viewerDataList;
+        Eigen::AlignedBox3f bounds;
+        std::vector<std::array<unsigned int, 4>> meshDataVersions; // the versions of the mesh data the viewer data was made of
+        struct Attributes // per viewer data, what the GPU buffers take besides the mesh data
+        {
+            MeshData::Matrix vertexNormals; // empty when the normals of the mesh data are used as they are
+            MeshData::Matrix faceNormals;
+            MeshData::Matrix gridTextureCoords; // for mesh data without texture coordinates (see ViewerData::grid_texture)
+        };
+        std::vector<Attributes> attributes;
+        // per viewer data trees of the faces, vertices and edges for picking (built on the first use)
+        struct PickingTrees
+        {
+            Eigen::MatrixXd V; // the vertices of the trees (which work in double precision)
+            std::shared_ptr<igl::AABB<Eigen::MatrixXd, 3>> trees[3];
+            Eigen::MatrixXi elements[3]; // the elements of the vertex and edge trees (the faces are in the viewer data)
+        };
+        std::vector<PickingTrees> pickingTrees;
+        std::vector<std::shared_ptr<MeshClusters>> clusters; // per viewer data, for meshes large enough to cull in parts
+        struct VertexFaces // the faces around each vertex (see igl::vertex_triangle_adjacency), built on the first partial update
+        {
+            Eigen::VectorXi faces, offsets;
+        };
+        std::vector<VertexFaces> vertexFaces;
+        bool editedDirectly = false; // edited through EditViewerData (then the viewer data is the source of the GPU buffers)
+
+        [[nodiscard]] const MeshData* GetSource(int index) const; // the mesh data of the GPU buffers (null if it's the viewer data)
+        void Update(int index, unsigned int parts); // update from the changed parts (MeshData::DIRTY_*) of the mesh data
+        void FillViewerData(int index, unsigned int parts); // update the double precision copy of the mesh in the viewer data
+        void UpdateAndBindMesh(int index, const Program& program);
+        const Eigen::MatrixXd& GetPickingVertices(int index);
+        const igl::AABB<Eigen::MatrixXd, 3>& GetTree(int index, PrimitiveType type);
+        const Eigen::MatrixXi& GetElements(int index, PrimitiveType type) const;
+        const MeshClusters* GetClusters(int index); // null for small meshes
+        // update the normals and GPU buffers around moved vertices (false if they have to be updated whole)
+        bool UpdateVertices(int index, std::span<const int> vertices);
+        SharedMeshData() = default;
+        SharedMeshData(const SharedMeshData& other); // copies the CPU data only (the copy uploads its own GPU buffers)
+        SharedMeshData& operator=(const SharedMeshData&) = delete;
+        ~SharedMeshData(); // releases the GPU buffers (owned by the last model referencing the data)
+    };
+
+    static std::shared_ptr<SharedMeshData> GetSharedMeshData(const std::shared_ptr<Mesh>& mesh);
+    void SyncWithMeshes(); // update the viewer data of mesh data that was edited since it was made
     std::vector<std::shared_ptr<Mesh>> meshList;
-    std::vector<std::vector<igl::opengl::ViewerData>> viewerDataListPerMesh;
+    std::vector<std::shared_ptr<SharedMeshData>> sharedDataPerMesh;
+    AabbTree::Proxy spatialProxy; // membership in the spatial index of the scene the model is attached to
+    void UpdateSpatialIndex();
 
     // TODO: TAL: handle the colors...
     Eigen::RowVector4f ambient = Eigen::RowVector4f(1.0, 1.0, 1.0, 1.0);
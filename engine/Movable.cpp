@@ -1,5 +1,6 @@
 #include "Movable.h"
 #include "Visitor.h"
+#include "PoolAllocator.h"
 #include <iostream>
 #include <memory>
 
@@ -8,14 +9,15 @@ namespace cg3d
 {
 
 Movable::Movable(const Movable& other) : enable_shared_from_this(other), name(other.name + " copy"), isStatic(other.isStatic), isPickable(other.isPickable),
-        lineWidth(other.lineWidth), aggregatedTransform(other.aggregatedTransform), Tin(other.Tin), Tout(other.Tout)
+        lineWidth(other.lineWidth), aggregatedTransform(other.aggregatedTransform), preciseTranslation(other.preciseTranslation),
+        Tin(other.Tin), Tout(other.Tout)
 {
     // todo: copy the children
 }
 
 std::shared_ptr<Movable> Movable::Create(std::string name, const std::shared_ptr<Movable>& parent)
 {
-    auto movable = std::make_shared<Movable>(std::move(name));
+    auto movable = std::allocate_shared<Movable>(PoolAllocator<Movable>(), std::move(name));
     movable->SetParent(parent);
     return movable;
 }
@@ -32,10 +34,18 @@ const Eigen::Vector3f& Movable::AxisVec(Axis axis)
 
 void Movable::PropagateTransform() // NOLINT(misc-no-recursion)
 {
-    if (auto p = parent.lock()) // use the aggregatedTransform of the parent
-        aggregatedTransform = p->aggregatedTransform * Tout.matrix() * Tin.matrix();
-    else // there is no parent
-        aggregatedTransform = Tout.matrix() * Tin.matrix();
+    // the translation is aggregated separately in double precision (the rotation and scale are fine in single precision)
+    Eigen::Matrix3f toutLinear = Tout.RotationMatrix() * Tout.scale.asDiagonal();
+    Eigen::Vector3d translation = Tout.translation + toutLinear.cast<double>() * Tin.translation;
+
+    if (auto p = parent.lock()) { // use the aggregatedTransform of the parent
+        aggregatedTransform = p->aggregatedTransform * GetTransform();
+        preciseTranslation = p->preciseTranslation + p->aggregatedTransform.block<3, 3>(0, 0).cast<double>() * translation;
+    } else { // there is no parent
+        aggregatedTransform = GetTransform();
+        preciseTranslation = translation;
+    }
+    aggregatedTransform.block<3, 1>(0, 3) = preciseTranslation.cast<float>();
 
     for (const auto& child: children)
         child->PropagateTransform();
@@ -43,15 +53,15 @@ void Movable::PropagateTransform() // NOLINT(misc-no-recursion)
 
 void Movable::SetCenter(const Eigen::Vector3f& point)
 {
-    Tout.pretranslate(point);
-    Tin.pretranslate(-point);
+    Tout.Pretranslate(point);
+    Tin.Pretranslate(-point);
     PropagateTransform();
 }
 
 void Movable::Translate(const Eigen::Vector3f& vec)
 {
     if (isStatic) return;
-    Tout.pretranslate(vec);
+    Tout.Pretranslate(vec);
     PropagateTransform();
 }
 
@@ -70,7 +80,14 @@ void Movable::Translate(float dist, Axis axis)
 void Movable::TranslateInSystem(const Eigen::Matrix3f& system, const Eigen::Vector3f& vec)
 {
     if (isStatic) return;
-    Tout.pretranslate(system.transpose() * vec);
+    Tout.Pretranslate(system.transpose() * vec);
+    PropagateTransform();
+}
+
+void Movable::SetTranslation(const Eigen::Vector3d& translation)
+{
+    if (isStatic) return;
+    Tout.translation = translation;
     PropagateTransform();
 }
 
@@ -82,7 +99,7 @@ Eigen::Vector3f Movable::GetTranslation() const
 void Movable::Rotate(const Eigen::Matrix3f& rot)
 {
     if (isStatic) return;
-    Tout.rotate(rot);
+    Tout.Rotate(rot);
     PropagateTransform();
 }
 
@@ -94,7 +111,7 @@ void Movable::Rotate(float angle, Axis axis)
 void Movable::Rotate(float angle, const Eigen::Vector3f& axisVec)
 {
     if (isStatic) return;
-    Tout.rotate(Eigen::AngleAxisf(angle, axisVec));
+    Tout.Rotate(Eigen::AngleAxisf(angle, axisVec));
     PropagateTransform();
 }
 
@@ -106,14 +123,14 @@ void Movable::RotateByDegree(float degree, Axis axis)
 void Movable::RotateByDegree(float degree, const Eigen::Vector3f& axisVec)
 {
     if (isStatic) return;
-    Tout.rotate(Eigen::AngleAxisf(degree * float(PI_DIV_180), axisVec));
+    Tout.Rotate(Eigen::AngleAxisf(degree * float(PI_DIV_180), axisVec));
     PropagateTransform();
 }
 
 void Movable::RotateInSystem(const Eigen::Matrix3f& system, float angle, Axis axis)
 {
     if (isStatic) return;
-    Tout.rotate(Eigen::AngleAxisf(angle, Tout.rotation().transpose() * system.transpose() * AxisVec(axis)));
+    Tout.Rotate(Eigen::AngleAxisf(angle, Tout.rotation.conjugate() * (system.transpose() * AxisVec(axis))));
     PropagateTransform();
 }
 
@@ -138,7 +155,7 @@ void Movable::Scale(float factor, Axis axis)
 void Movable::Scale(const Eigen::Vector3f& scaleVec)
 {
     if (isStatic) return;
-    Tin.scale(scaleVec);
+    Tin.Scale(scaleVec);
     PropagateTransform();
 }
 
@@ -163,11 +180,14 @@ void Movable::SetParent(const std::shared_ptr<Movable>& newParent, bool retransf
             if (std::find_if(newParent->children.begin(), newParent->children.end(), compareToThis) == newParent->children.end()) {
                 newParent->children.emplace_back(shared_from_this());
                 if (retransform) { // calculate current translation/rotation in relation to the new parent
-                    Tout.matrix() = newParent->aggregatedTransform.inverse() * aggregatedTransform;
-                    Tin = Eigen::Affine3f::Identity();
+                    Tout = Trs::FromMatrix(newParent->aggregatedTransform.inverse() * aggregatedTransform);
+                    Tin = Trs::Identity();
+                    std::swap(Tin.scale, Tout.scale); // keep the scale in Tin so later rotations of Tout stay exact
                 }
                 PropagateTransform();
             }
+        } else if (oldParent != nullptr) {
+            PropagateTransform(); // detached (also lets models leave the spatial index of the scene)
         }
     }
 }
@@ -207,29 +227,29 @@ Eigen::Matrix4f Movable::GetAggregatedTransform() const
     return aggregatedTransform;
 }
 
-Eigen::Affine3f Movable::GetTin() const
+const Trs& Movable::GetTin() const
 {
     return Tin;
 }
 
-Eigen::Affine3f Movable::GetTout() const
+const Trs& Movable::GetTout() const
 {
     return Tout;
 }
 
-void Movable::SetTin(const Eigen::Affine3f& newTin)
+void Movable::SetTin(const Trs& newTin)
 {
     Tin = newTin;
     PropagateTransform();
 }
 
-void Movable::SetTout(const Eigen::Affine3f& newTout)
+void Movable::SetTout(const Trs& newTout)
 {
     Tout = newTout;
     PropagateTransform();
 }
 
-void Movable::SetTinTout(const Eigen::Affine3f& newTin, const Eigen::Affine3f& newTout)
+void Movable::SetTinTout(const Trs& newTin, const Trs& newTout)
 {
     Tin = newTin;
     Tout = newTout;
@@ -238,12 +258,17 @@ void Movable::SetTinTout(const Eigen::Affine3f& newTin, const Eigen::Affine3f& n
 
 Eigen::Matrix4f Movable::GetTransform()
 {
-    return Tout.matrix() * Tin.matrix();
+    Eigen::Matrix4f matrices[2];
+    const Trs trs[]{Tout, Tin};
+    Trs::ToMatrices(trs, matrices, 2);
+    return matrices[0] * matrices[1];
 }
 
 void Movable::SetTransform(const Eigen::Matrix4f& transform)
 {
-    SetTinTout(GetScaling(transform), GetTranslationRotation(transform));
+    Trs newTout = Trs::FromMatrix(transform), newTin;
+    std::swap(newTin.scale, newTout.scale);
+    SetTinTout(newTin, newTout);
 }
 
 } // namespace cg3d
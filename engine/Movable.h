@@ -4,6 +4,7 @@
 #include "Program.h"
 #include "Mesh.h"
 #include "Material.h"
+#include "Trs.h"
 
 
 namespace cg3d
@@ -41,6 +42,8 @@ public:
     virtual void Translate(float dist, Axis axis);
     virtual void Translate(const Eigen::Vector3f& vec);
     virtual void TranslateInSystem(const Eigen::Matrix3f& system, const Eigen::Vector3f& vec);
+    // set the translation of Tout (in the space of the parent) in double precision, for nodes far from the origin
+    virtual void SetTranslation(const Eigen::Vector3d& translation);
     virtual Eigen::Vector3f GetTranslation() const;
 
     virtual void Rotate(const Eigen::Matrix3f& rot);
@@ -62,11 +65,14 @@ public:
     virtual Eigen::Matrix4f GetTransform();
     virtual void SetTransform(const Eigen::Matrix4f& transform);
     virtual void PropagateTransform(); // recursively propagates the transform
-    virtual Eigen::Affine3f GetTin() const;
-    virtual Eigen::Affine3f GetTout() const;
-    virtual void SetTin(const Eigen::Affine3f &newTin);
-    virtual void SetTout(const Eigen::Affine3f &newTout);
-    virtual void SetTinTout(const Eigen::Affine3f &newTin, const Eigen::Affine3f& newTout);
+    virtual const Trs& GetTin() const;
+    virtual const Trs& GetTout() const;
+    virtual void SetTin(const Trs& newTin);
+    virtual void SetTout(const Trs& newTout);
+    virtual void SetTinTout(const Trs& newTin, const Trs& newTout);
+    void SetTin(const Eigen::Affine3f& newTin) { SetTin(Trs::FromAffine(newTin)); }
+    void SetTout(const Eigen::Affine3f& newTout) { SetTout(Trs::FromAffine(newTout)); }
+    void SetTinTout(const Eigen::Affine3f& newTin, const Eigen::Affine3f& newTout) { SetTinTout(Trs::FromAffine(newTin), Trs::FromAffine(newTout)); }
 
     // helper functions
     static const Eigen::Vector3f& AxisVec(Axis axis);
@@ -76,7 +82,8 @@ public:
     static Eigen::Affine3f GetScaling(const Eigen::Matrix4f& _transform);
 
     Eigen::Matrix4f aggregatedTransform{Eigen::Matrix4f::Identity()}; // aggregation of all transformations starting from top level
-    Eigen::Affine3f Tout{Eigen::Affine3f::Identity()}, Tin{Eigen::Affine3f::Identity()}; // transformations of *this* object (only)
+    Eigen::Vector3d preciseTranslation{Eigen::Vector3d::Zero()}; // translation part of aggregatedTransform in double precision
+    Trs Tout, Tin; // transformations of *this* object (only), baked into aggregatedTransform by PropagateTransform
     float lineWidth = 2;
     bool isPickable = true;
     bool isStatic = false;
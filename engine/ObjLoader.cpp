@@ -8,22 +8,121 @@
 
 #include "Mesh.h"
 #include "Model.h"
+#include "MeshOptimizer.h"
+#include "MeshCache.h"
+#include "ObjParser.h"
+#include "ThreadPool.h"
+#include "Debug.h"
 #include <memory>
 #include <algorithm>
+#include <unordered_map>
 
 
 namespace cg3d
 {
 
+namespace
+{
+
+void OptimizeMesh(MeshData& meshData, const std::string& name)
+{
+    if (ObjLoader::optimizeMeshes && meshData.GetFaces().rows() > 0) {
+        auto report = MeshOptimizer::Optimize(meshData);
+        meshData.ClearDirty();
+        debug("mesh ", name, ": ACMR ", report.acmrBefore, " -> ", report.acmrAfter, ", ATVR ", report.atvrBefore, " -> ", report.atvrAfter);
+    }
+}
+
+struct CornerHash
+{
+    std::size_t operator()(const ObjParser::Corner& corner) const
+    {
+        return std::size_t(corner.position) * 73856093u ^ std::size_t(corner.uv) * 19349663u ^ std::size_t(corner.normal) * 83492791u;
+    }
+};
+
+struct CornerEqual
+{
+    bool operator()(const ObjParser::Corner& a, const ObjParser::Corner& b) const
+    {
+        return a.position == b.position && a.uv == b.uv && a.normal == b.normal;
+    }
+};
+
+} // namespace
+
+MeshData ObjLoader::MeshDataFromObjParser(const ObjParser& parser, int group)
+{
+    const auto& corners = parser.groups[group].corners;
+    const int n = int(corners.size());
+
+    // a vertex per distinct (position, uv, normal) index triple, so vertices are split only at real seams
+    std::unordered_map<ObjParser::Corner, int, CornerHash, CornerEqual> cornerVertices;
+    cornerVertices.reserve(std::size_t(n) / 2);
+    std::vector<int> vertexCorners; // the first corner of each vertex
+    MeshData::IndexMatrix F(n / 3, 3);
+    for (int i = 0; i < n; i++) {
+        auto [it, isNew] = cornerVertices.try_emplace(corners[i], int(vertexCorners.size()));
+        if (isNew) vertexCorners.push_back(i);
+        F(i / 3, i % 3) = it->second;
+    }
+
+    const int vertexCount = int(vertexCorners.size());
+    MeshData::Matrix V(vertexCount, 3), V_normals(vertexCount, 3), V_uv(vertexCount, 2);
+    ThreadPool::Global().ParallelFor(0, vertexCount, 1 << 14, [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            const auto& corner = corners[vertexCorners[i]];
+            V.row(i) = Eigen::Map<const Eigen::RowVector3f>(&parser.positions[3 * corner.position]);
+            if (corner.normal >= 0)
+                V_normals.row(i) = Eigen::Map<const Eigen::RowVector3f>(&parser.normals[3 * corner.normal]);
+            else
+                V_normals.row(i).setZero(); // (computed when the mesh is drawn)
+            if (corner.uv >= 0)
+                V_uv.row(i) = Eigen::Map<const Eigen::RowVector2f>(&parser.uvs[2 * corner.uv]);
+            else
+                V_uv.row(i).setZero();
+        }
+    });
+
+    MeshData meshData{std::move(V), std::move(F), std::move(V_normals), std::move(V_uv)};
+    OptimizeMesh(meshData, parser.groups[group].name);
+
+    return meshData;
+}
+
+std::vector<MeshData> ObjLoader::MeshDataListFromObjParser(const ObjParser& parser)
+{
+    std::vector<MeshData> dataList;
+    for (int i = 0; i < int(parser.groups.size()); i++)
+        dataList.emplace_back(MeshDataFromObjParser(parser, i));
+
+    return dataList;
+}
+
+std::vector<MeshData> ObjLoader::MeshDataListFromObjFile(const std::string& file)
+{
+    std::vector<MeshData> dataList;
+    if (MeshCache::Load(file, unsigned(optimizeMeshes), dataList))
+        return dataList;
+
+    ObjParser parser;
+    if (parser.ParseFile(file)) {
+        dataList = MeshDataListFromObjParser(parser);
+        MeshCache::Save(file, unsigned(optimizeMeshes), dataList);
+    }
+
+    return dataList;
+}
+
 MeshData ObjLoader::MeshDataFromObjLoader(const objl::Mesh& loadedMesh)
 {
     const auto& vertices = loadedMesh.Vertices;
     const auto& indices = loadedMesh.Indices;
 
-    Eigen::MatrixXd V(vertices.size(), 3);
-    Eigen::MatrixXi F(indices.size() / 3, 3);
-    Eigen::MatrixXd V_normals(vertices.size(), 3);
-    Eigen::MatrixXd V_uv(vertices.size(), 2);
+    MeshData::Matrix V(vertices.size(), 3);
+    MeshData::IndexMatrix F(indices.size() / 3, 3);
+    MeshData::Matrix V_normals(vertices.size(), 3);
+    MeshData::Matrix V_uv(vertices.size(), 2);
 
     // import the vertices data
     int j = 0;
@@ -49,7 +148,10 @@ MeshData ObjLoader::MeshDataFromObjLoader(const objl::Mesh& loadedMesh)
 
     // todo: add face normals?
 
-    return {V, F, V_normals, V_uv};
+    MeshData meshData{std::move(V), std::move(F), std::move(V_normals), std::move(V_uv)};
+    OptimizeMesh(meshData, loadedMesh.MeshName);
+
+    return meshData;
 }
 
 std::vector<MeshData> ObjLoader::MeshDataListFromObjLoader(const objl::Loader& loader)
@@ -63,23 +165,32 @@ std::vector<MeshData> ObjLoader::MeshDataListFromObjLoader(const objl::Loader& l
 
 std::shared_ptr<Mesh> ObjLoader::MeshFromObj(std::string name, const std::vector<std::string>& files)
 {
-    objl::Loader loader;
-    std::vector<MeshData> dataList;
+    // load the files concurrently (ParallelFor, unlike waiting on futures, is safe inside the pool tasks of the async loads)
+    std::vector<std::vector<MeshData>> dataPerFile(files.size());
+    ThreadPool::Global().ParallelFor(0, int(files.size()), 1, [&](int begin, int end) {
+        for (int i = begin; i < end; i++)
+            dataPerFile[i] = MeshDataListFromObjFile(files[i]);
+    });
 
-    for (const auto& file: files) {
-        loader.LoadFile(file);
-        auto moreData{MeshDataListFromObjLoader(loader)};
+    std::vector<MeshData> dataList;
+    for (auto& moreData: dataPerFile)
         std::move(moreData.begin(), moreData.end(), std::back_inserter(dataList));
-    }
 
-    return std::make_shared<Mesh>(std::move(name), dataList);
+    return std::make_shared<Mesh>(std::move(name), std::move(dataList));
+}
+
+std::future<std::shared_ptr<Mesh>> ObjLoader::MeshFromObjAsync(std::string name, std::vector<std::string> files)
+{
+    return ThreadPool::Global().Submit([name = std::move(name), files = std::move(files)]() mutable {
+        return MeshFromObj(std::move(name), files);
+    });
 }
 
 std::shared_ptr<Mesh> ObjLoader::MeshFromObj(std::string name, std::istream& in)
 {
-    objl::Loader loader;
-    loader.LoadFile(in);
-    return MeshFromObjLoader(std::move(name), loader);
+    ObjParser parser;
+    parser.Parse(in);
+    return std::make_shared<Mesh>(std::move(name), MeshDataListFromObjParser(parser));
 }
 
 std::shared_ptr<Mesh> ObjLoader::MeshFromObjLoader(std::string name, const objl::Mesh& loadedMesh)
@@ -94,16 +205,38 @@ std::shared_ptr<Mesh> ObjLoader::MeshFromObjLoader(std::string name, objl::Loade
 
 std::shared_ptr<Model> ObjLoader::ModelFromObj(std::string name, std::istream& in, std::shared_ptr<Material> material)
 {
-    objl::Loader loader;
-    loader.LoadFile(in);
-    return ModelFromObjLoader(std::move(name), loader, std::move(material));
+    ObjParser parser;
+    parser.Parse(in);
+    return ModelFromObjParser(std::move(name), parser, std::move(material));
 }
 
 std::shared_ptr<Model> ObjLoader::ModelFromObj(std::string name, const std::string& file, std::shared_ptr<Material> material)
 {
-    objl::Loader loader;
-    loader.LoadFile(file);
-    return ModelFromObjLoader(std::move(name), loader, std::move(material));
+    return ModelFromMeshDataList(std::move(name), MeshDataListFromObjFile(file), std::move(material));
+}
+
+std::future<std::shared_ptr<Model>> ObjLoader::ModelFromObjAsync(std::string name, std::string file, std::shared_ptr<Material> material)
+{
+    return ThreadPool::Global().Submit([name = std::move(name), file = std::move(file), material = std::move(material)]() mutable {
+        return ModelFromObj(std::move(name), file, std::move(material));
+    });
+}
+
+std::shared_ptr<Model> ObjLoader::ModelFromObjParser(std::string name, const ObjParser& parser, std::shared_ptr<Material> material)
+{
+    return ModelFromMeshDataList(std::move(name), MeshDataListFromObjParser(parser), std::move(material));
+}
+
+std::shared_ptr<Model> ObjLoader::ModelFromMeshDataList(std::string name, std::vector<MeshData> dataList, std::shared_ptr<Material> material)
+{
+    std::vector<std::shared_ptr<Mesh>> meshList;
+
+    for (int i = 0; i < int(dataList.size()); i++) {
+        std::string meshName = name + "_mesh" + (dataList.size() > 1 ? std::to_string(i + 1) : "");
+        meshList.emplace_back(std::make_shared<Mesh>(std::move(meshName), std::vector<MeshData>{std::move(dataList[i])}));
+    }
+
+    return Model::Create(std::move(name), meshList, std::move(material));
 }
 
 std::shared_ptr<Model> ObjLoader::ModelFromObjLoader(std::string name, objl::Loader& loader, std::shared_ptr<Material> material)
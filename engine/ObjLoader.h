@@ -1,5 +1,6 @@
 #pragma  once
 
+#include <future>
 #include <string>
 #include <memory>
 #include <utility>
@@ -16,23 +17,41 @@ struct Mesh;
 namespace cg3d
 {
 
-struct MeshData;
+template<typename Scalar> class MeshDataT;
+using MeshData = MeshDataT<float>;
 class Mesh;
 class Model;
 class Material;
+class ObjParser;
 
 struct ObjLoader
 {
+    // reorder the loaded meshes for the vertex cache and fetch (see MeshOptimizer)
+    // (the welding of the attribute triples already numbers the vertices by their first use, not by the file)
+    static inline bool optimizeMeshes = true;
+
+    // the files and streams are read with ObjParser, the objl::Loader overloads are for meshes already loaded with it
+    static MeshData MeshDataFromObjParser(const ObjParser& parser, int group);
+    static std::vector<MeshData> MeshDataListFromObjParser(const ObjParser& parser);
+    static std::vector<MeshData> MeshDataListFromObjFile(const std::string& file); // from the binary cache of the file if it's valid (see MeshCache)
     static MeshData MeshDataFromObjLoader(const objl::Mesh& loadedMesh);
     static std::vector<MeshData> MeshDataListFromObjLoader(const objl::Loader& loader);
 
     static std::shared_ptr<Mesh> MeshFromObj(std::string name, const std::vector<std::string>& files);
     static std::shared_ptr<Mesh> MeshFromObj(std::string name, std::istream& in);
+
+    // load in the background on the thread pool, so a scene can keep rendering while assets stream in (the models
+    // aren't attached to a parent: attach them on the render thread once the future is ready, see std::future::wait_for)
+    static std::future<std::shared_ptr<Mesh>> MeshFromObjAsync(std::string name, std::vector<std::string> files);
+    static std::future<std::shared_ptr<Model>> ModelFromObjAsync(std::string name, std::string file, std::shared_ptr<Material> material);
+
     static std::shared_ptr<Mesh> MeshFromObjLoader(std::string name, objl::Loader& loader);
 
     static std::shared_ptr<Mesh> MeshFromObjLoader(std::string name, const objl::Mesh& loadedMesh);
     static std::shared_ptr<Model> ModelFromObj(std::string name, const std::string& file, std::shared_ptr<Material> material);
     static std::shared_ptr<Model> ModelFromObj(std::string name, std::istream& in, std::shared_ptr<Material> material);
+    static std::shared_ptr<Model> ModelFromObjParser(std::string name, const ObjParser& parser, std::shared_ptr<Material> material);
+    static std::shared_ptr<Model> ModelFromMeshDataList(std::string name, std::vector<MeshData> dataList, std::shared_ptr<Material> material);
     static std::shared_ptr<Model> ModelFromObjLoader(std::string name, objl::Loader& loader, std::shared_ptr<Material> material);
 
     template<typename... T> static std::shared_ptr<Mesh> MeshFromObjFiles(std::string name, const T&... files) {
@@ -0,0 +1,229 @@
+#include "ObjParser.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <istream>
+#include <iterator>
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+
+namespace cg3d
+{
+
+// the results of parsing a chunk of the file (the lines of a chunk only know the counts of the previous chunks after all are parsed)
+struct ObjParser::Chunk
+{
+    std::vector<float> positions, uvs, normals;
+    std::vector<Corner> corners;
+    std::vector<int> relativeIndices; // the attributes (3 * corner + attribute) given by negative indices, relative to the chunk start
+    struct GroupChange
+    {
+        std::size_t corner; // the number of corners before the change
+        bool isName; // o or g (otherwise usemtl)
+        std::string name;
+    };
+    std::vector<GroupChange> groupChanges;
+};
+
+namespace
+{
+
+inline bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+inline const char* SkipSpaces(const char* p, const char* end)
+{
+    while (p < end && IsSpace(*p)) p++;
+    return p;
+}
+
+inline const char* ParseFloat(const char* p, const char* end, float& value)
+{
+    p = SkipSpaces(p, end);
+    if (p < end && *p == '+') p++; // (from_chars doesn't take a plus sign)
+    auto result = std::from_chars(p, end, value);
+    if (result.ec != std::errc()) value = 0;
+    return result.ptr;
+}
+
+// parse an index of a face corner (1 based, negative indices count back from the last element read), -1 if missing
+inline const char* ParseIndex(const char* p, const char* end, int count, int& index, bool& relative)
+{
+    int value = 0;
+    auto result = std::from_chars(p, end, value);
+    relative = result.ec == std::errc() && value < 0;
+    if (result.ec != std::errc() || value == 0)
+        index = -1;
+    else
+        index = value > 0 ? value - 1 : count + value;
+    return result.ptr;
+}
+
+inline std::string Tail(const char* p, const char* end)
+{
+    p = SkipSpaces(p, end);
+    while (end > p && IsSpace(end[-1])) end--;
+    return {p, end};
+}
+
+} // namespace
+
+void ObjParser::ParseChunk(const char* begin, const char* end, Chunk& chunk)
+{
+    std::vector<std::pair<Corner, int>> polygon; // the corners and which of their indices are relative
+    for (const char* line = begin; line < end;) {
+        auto lineEnd = static_cast<const char*>(std::memchr(line, '\n', std::size_t(end - line)));
+        if (lineEnd == nullptr) lineEnd = end;
+        const char* p = SkipSpaces(line, lineEnd);
+        const char* keyword = p;
+        while (p < lineEnd && !IsSpace(*p)) p++;
+        auto keywordLength = p - keyword;
+
+        if (keywordLength == 1 && keyword[0] == 'v') {
+            float x, y, z;
+            p = ParseFloat(ParseFloat(ParseFloat(p, lineEnd, x), lineEnd, y), lineEnd, z);
+            chunk.positions.insert(chunk.positions.end(), {x, y, z});
+        } else if (keywordLength == 2 && keyword[0] == 'v' && keyword[1] == 't') {
+            float u, v = 0;
+            p = ParseFloat(p, lineEnd, u);
+            if (SkipSpaces(p, lineEnd) < lineEnd) ParseFloat(p, lineEnd, v);
+            chunk.uvs.insert(chunk.uvs.end(), {u, v});
+        } else if (keywordLength == 2 && keyword[0] == 'v' && keyword[1] == 'n') {
+            float x, y, z;
+            p = ParseFloat(ParseFloat(ParseFloat(p, lineEnd, x), lineEnd, y), lineEnd, z);
+            chunk.normals.insert(chunk.normals.end(), {x, y, z});
+        } else if (keywordLength == 1 && keyword[0] == 'f') {
+            polygon.clear();
+            while ((p = SkipSpaces(p, lineEnd)) < lineEnd) {
+                Corner corner{-1, -1, -1};
+                bool relative[3]{};
+                p = ParseIndex(p, lineEnd, int(chunk.positions.size() / 3), corner.position, relative[0]);
+                if (p < lineEnd && *p == '/') {
+                    p = ParseIndex(p + 1, lineEnd, int(chunk.uvs.size() / 2), corner.uv, relative[1]);
+                    if (p < lineEnd && *p == '/')
+                        p = ParseIndex(p + 1, lineEnd, int(chunk.normals.size() / 3), corner.normal, relative[2]);
+                }
+                while (p < lineEnd && !IsSpace(*p)) p++; // (skip anything unexpected)
+                polygon.push_back({corner, relative[0] | relative[1] << 1 | relative[2] << 2});
+            }
+            for (int i = 1; i + 1 < int(polygon.size()); i++) {
+                for (int k: {0, i, i + 1}) {
+                    for (int attribute = 0; attribute < 3; attribute++)
+                        if (polygon[k].second & (1 << attribute))
+                            chunk.relativeIndices.push_back(int(chunk.corners.size()) * 3 + attribute);
+                    chunk.corners.push_back(polygon[k].first);
+                }
+            }
+        } else if ((keywordLength == 1 && (keyword[0] == 'o' || keyword[0] == 'g')) || (keywordLength == 6 && std::memcmp(keyword, "usemtl", 6) == 0)) {
+            chunk.groupChanges.push_back({chunk.corners.size(), keywordLength == 1, keywordLength == 1 ? Tail(p, lineEnd) : std::string()});
+        }
+
+        line = lineEnd + 1;
+    }
+}
+
+bool ObjParser::ParseFile(const std::string& file)
+{
+    MappedFile mappedFile(file);
+    if (!mappedFile.IsOpen()) {
+        positions.clear(), uvs.clear(), normals.clear(), groups.clear();
+        return false;
+    }
+    return Parse(mappedFile.GetData(), mappedFile.GetData() + mappedFile.GetSize());
+}
+
+bool ObjParser::Parse(std::istream& in)
+{
+    std::string text{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    return Parse(text.data(), text.data() + text.size());
+}
+
+bool ObjParser::Parse(const char* begin, const char* end)
+{
+    positions.clear(), uvs.clear(), normals.clear(), groups.clear();
+
+    // split the text at line ends into about equal chunks
+    auto& threadPool = ThreadPool::Global();
+    std::size_t size = end - begin;
+    int chunkCount = int(std::max<std::size_t>(1, std::min<std::size_t>(size / MIN_CHUNK_SIZE, 4 * (threadPool.GetThreadCount() + 1))));
+    std::vector<const char*> bounds{begin};
+    for (int i = 1; i < chunkCount; i++) {
+        const char* bound = std::max(begin + size * i / chunkCount, bounds.back());
+        auto lineEnd = static_cast<const char*>(std::memchr(bound, '\n', std::size_t(end - bound)));
+        bounds.push_back(lineEnd == nullptr ? end : lineEnd + 1);
+    }
+    bounds.push_back(end);
+
+    std::vector<Chunk> chunks(chunkCount);
+    threadPool.ParallelFor(0, chunkCount, 1, [&](int chunkBegin, int chunkEnd) {
+        for (int c = chunkBegin; c < chunkEnd; c++)
+            ParseChunk(bounds[c], bounds[c + 1], chunks[c]);
+    });
+
+    // gather the attributes, offsetting the relative indices by the counts of the previous chunks
+    std::vector<std::size_t> attributeOffsets[3]; // (in floats)
+    std::size_t attributeSizes[3]{};
+    for (auto& chunk: chunks) {
+        const std::vector<float>* chunkAttributes[3]{&chunk.positions, &chunk.uvs, &chunk.normals};
+        for (int a = 0; a < 3; a++) {
+            attributeOffsets[a].push_back(attributeSizes[a]);
+            attributeSizes[a] += chunkAttributes[a]->size();
+        }
+    }
+    positions.resize(attributeSizes[0]);
+    uvs.resize(attributeSizes[1]);
+    normals.resize(attributeSizes[2]);
+    const int counts[3]{int(positions.size() / 3), int(uvs.size() / 2), int(normals.size() / 3)};
+
+    threadPool.ParallelFor(0, chunkCount, 1, [&](int chunkBegin, int chunkEnd) {
+        for (int c = chunkBegin; c < chunkEnd; c++) {
+            auto& chunk = chunks[c];
+            std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + std::ptrdiff_t(attributeOffsets[0][c]));
+            std::copy(chunk.uvs.begin(), chunk.uvs.end(), uvs.begin() + std::ptrdiff_t(attributeOffsets[1][c]));
+            std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + std::ptrdiff_t(attributeOffsets[2][c]));
+            const int offsets[3]{int(attributeOffsets[0][c] / 3), int(attributeOffsets[1][c] / 2), int(attributeOffsets[2][c] / 3)};
+            for (int slot: chunk.relativeIndices) {
+                auto& corner = chunk.corners[slot / 3];
+                int& index = slot % 3 == 0 ? corner.position : slot % 3 == 1 ? corner.uv : corner.normal;
+                index += offsets[slot % 3];
+            }
+            for (auto& corner: chunk.corners) { // (out of range indices are treated as missing)
+                if (corner.position >= counts[0] || corner.position < 0) corner.position = -1;
+                if (corner.uv >= counts[1] || corner.uv < 0) corner.uv = -1;
+                if (corner.normal >= counts[2] || corner.normal < 0) corner.normal = -1;
+            }
+        }
+    });
+
+    // split the faces into groups where the object, group or material changes (skipping triangles without positions)
+    Group group;
+    auto append = [&group](const std::vector<Corner>& corners, std::size_t from, std::size_t to) {
+        for (std::size_t i = from; i < to; i += 3)
+            if (corners[i].position >= 0 && corners[i + 1].position >= 0 && corners[i + 2].position >= 0)
+                group.corners.insert(group.corners.end(), corners.begin() + std::ptrdiff_t(i), corners.begin() + std::ptrdiff_t(i + 3));
+    };
+    for (auto& chunk: chunks) {
+        std::size_t from = 0;
+        for (auto& change: chunk.groupChanges) {
+            append(chunk.corners, from, change.corner);
+            from = change.corner;
+            if (!group.corners.empty()) {
+                std::string name = change.isName ? std::move(change.name) : group.name; // (a new material keeps the name)
+                groups.emplace_back(std::move(group));
+                group = {};
+                group.name = std::move(name);
+            } else if (change.isName) {
+                group.name = std::move(change.name);
+            }
+        }
+        append(chunk.corners, from, chunk.corners.size());
+        chunk = {}; // (release the memory early)
+    }
+    if (!group.corners.empty())
+        groups.emplace_back(std::move(group));
+
+    return !groups.empty();
+}
+
+} // namespace cg3d
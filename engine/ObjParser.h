@@ -0,0 +1,44 @@
+#pragma once
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+
+namespace cg3d
+{
+
+// parser of Wavefront OBJ files (the positions, texture coordinates, normals and faces), parsing chunks of the file in parallel
+class ObjParser
+{
+public:
+    static constexpr int MIN_CHUNK_SIZE = 1 << 20; // smaller files are parsed on the calling thread
+
+    struct Corner // indices of the attributes of a face corner (-1 if missing)
+    {
+        int position, uv, normal;
+    };
+
+    // the faces between object, group and material changes (split as objl::Loader splits its meshes)
+    struct Group
+    {
+        std::string name;
+        std::vector<Corner> corners; // 3 per triangle (polygons are triangulated as fans)
+    };
+
+    std::vector<float> positions; // 3 per vertex
+    std::vector<float> uvs; // 2 per texture coordinate
+    std::vector<float> normals; // 3 per normal
+    std::vector<Group> groups; // the groups that have faces
+
+    // parse a file (memory mapped), a stream or a text, replacing the previous results (false if there are no faces)
+    bool ParseFile(const std::string& file);
+    bool Parse(std::istream& in);
+    bool Parse(const char* begin, const char* end);
+
+private:
+    struct Chunk;
+    static void ParseChunk(const char* begin, const char* end, Chunk& chunk);
+};
+
+} // namespace cg3d
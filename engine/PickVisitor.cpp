@@ -43,13 +43,13 @@ void PickVisitor::Visit(Model* model)
 
     if (!model->isHidden) {
         auto& program = *model->material->BindFixedColorProgram();
-        scene->Update(program, proj, view, model->isStatic ? model->aggregatedTransform : norm * model->aggregatedTransform);
+        scene->Update(program, proj, view, ModelTransform(model));
         models.emplace_back(model);
 
         int id = int(models.size()); // temporary id for the model (translated to color below)
         int r = (id & 0x000000FF) >> 0;
-        int g = (id & 0x000000FF) >> 8;
-        int b = (id & 0x000000FF) >> 16;
+        int g = (id & 0x0000FF00) >> 8;
+        int b = (id & 0x00FF0000) >> 16;
         program.SetUniform4f("fixedColor", r / 255.0f, g / 255.0f, b / 255.0f, 1.0f); // NOLINT(cppcoreguidelines-narrowing-conversions)
         model->UpdateDataAndDrawMeshes(program, true, false);
     }
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+
+namespace cg3d
+{
+
+// pool of fixed size blocks, allocated in chunks and recycled through a free list
+class FixedSizePool
+{
+public:
+    FixedSizePool(std::size_t blockSize, std::size_t alignment, std::size_t blocksPerChunk = 256)
+            : alignment(std::max(alignment, alignof(void*))),
+              blockSize((std::max(blockSize, sizeof(void*)) + this->alignment - 1) / this->alignment * this->alignment),
+              blocksPerChunk(blocksPerChunk) {}
+
+    FixedSizePool(const FixedSizePool&) = delete;
+    void operator=(const FixedSizePool&) = delete;
+
+    ~FixedSizePool()
+    {
+        for (void* chunk: chunks)
+            ::operator delete(chunk, std::align_val_t(alignment));
+    }
+
+    void* Allocate()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!freeList) {
+            auto* chunk = static_cast<std::byte*>(::operator new(blockSize * blocksPerChunk, std::align_val_t(alignment)));
+            chunks.push_back(chunk);
+            for (std::size_t i = blocksPerChunk; i-- > 0;) // thread the new blocks into the free list
+                freeList = new(chunk + i * blockSize) FreeBlock{freeList};
+        }
+        FreeBlock* block = freeList;
+        freeList = block->next;
+        return block;
+    }
+
+    void Deallocate(void* p)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        freeList = new(p) FreeBlock{freeList};
+    }
+
+    // the pool of the blocks of the given type (never destroyed, so objects may outlive static destruction)
+    template<typename T>
+    static FixedSizePool& Of()
+    {
+        static auto* pool = new FixedSizePool(sizeof(T), alignof(T));
+        return *pool;
+    }
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    const std::size_t alignment, blockSize, blocksPerChunk; // (alignment first, the block size is rounded up to it)
+    FreeBlock* freeList = nullptr;
+    std::vector<void*> chunks;
+    std::mutex mutex;
+};
+
+// standard allocator over FixedSizePool, meant for std::allocate_shared (which allocates the object together with
+// its reference counts), so creating and destroying scene nodes doesn't go through the general purpose heap
+template<typename T>
+class PoolAllocator
+{
+public:
+    using value_type = T;
+
+    PoolAllocator() = default;
+    template<typename U> PoolAllocator(const PoolAllocator<U>&) noexcept {} // NOLINT(google-explicit-constructor)
+
+    T* allocate(std::size_t n)
+    {
+        if (n != 1) return std::allocator<T>().allocate(n);
+        return static_cast<T*>(FixedSizePool::Of<T>().Allocate());
+    }
+
+    void deallocate(T* p, std::size_t n)
+    {
+        if (n != 1) return std::allocator<T>().deallocate(p, n);
+        FixedSizePool::Of<T>().Deallocate(p);
+    }
+
+    template<typename U> bool operator==(const PoolAllocator<U>&) const noexcept { return true; }
+    template<typename U> bool operator!=(const PoolAllocator<U>&) const noexcept { return false; }
+};
+
+} // namespace cg3d
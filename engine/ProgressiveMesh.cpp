@@ -0,0 +1,426 @@
+#include "ProgressiveMesh.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <queue>
+#include <unordered_map>
+#include <Eigen/Geometry>
+#include "ThreadPool.h"
+#include "Debug.h"
+
+
+namespace cg3d
+{
+
+namespace
+{
+
+constexpr char MAGIC[8] = {'C', 'G', '3', 'D', 'P', 'M', '\0', '\0'};
+constexpr std::uint32_t VERSION = 1;
+constexpr std::uint32_t HAS_NORMALS = 1, HAS_TEXTURE_COORDS = 2;
+constexpr int PUBLISH_INTERVAL = 1024; // splits read between updates of the available count
+
+struct FileHeader
+{
+    char magic[8];
+    std::uint32_t version, flags;
+    std::int32_t vertexCount, faceCount, baseVertexCount, baseFaceCount, splitCount, reserved;
+};
+
+struct SplitHeader
+{
+    std::int32_t parent, faceCount, cornerCount;
+};
+
+// a recorded half-edge collapse of vertex v into vertex u
+struct Collapse
+{
+    int v = 0, u = 0; // v collapses into u
+    std::vector<int> removedFaces;
+    std::vector<std::array<int, 3>> removedCorners; // the corners of the removed faces before the collapse
+    std::vector<std::pair<int, int>> movedCorners; // (face, corner) pairs changed from v to u
+};
+
+struct Candidate
+{
+    double cost;
+    int v, u;
+    unsigned int stampV, stampU;
+    bool operator>(const Candidate& other) const { return cost > other.cost; }
+};
+
+class Simplifier
+{
+public:
+    Simplifier(const MeshData& meshData) : V(meshData.GetVertices().cast<double>()), n(int(V.rows())),
+            vertexFaces(n), quadrics(n, Eigen::Matrix4d::Zero()), locked(n, 0), stamps(n, 0)
+    {
+        alive.assign(n, 1);
+        const auto& F = meshData.GetFaces();
+        faces.resize(F.rows());
+        faceAlive.assign(F.rows(), 1);
+        for (int f = 0; f < int(F.rows()); f++) {
+            faces[f] = {F(f, 0), F(f, 1), F(f, 2)};
+            for (int v: faces[f])
+                vertexFaces[v].push_back(f);
+            Eigen::Vector3d p0 = V.row(faces[f][0]), p1 = V.row(faces[f][1]), p2 = V.row(faces[f][2]);
+            Eigen::Vector3d normal = (p1 - p0).cross(p2 - p0);
+            double doubleArea = normal.norm();
+            if (doubleArea == 0) continue;
+            Eigen::Vector4d plane;
+            plane << normal / doubleArea, -normal.dot(p0) / doubleArea;
+            Eigen::Matrix4d quadric = (doubleArea / 2) * plane * plane.transpose();
+            for (int v: faces[f])
+                quadrics[v] += quadric;
+        }
+        LockBoundaryAndSeams();
+    }
+
+    std::vector<Collapse> Run(int targetFaceCount)
+    {
+        for (int v = 0; v < n; v++)
+            for (int w: Neighbors(v))
+                Push(v, w);
+
+        std::vector<Collapse> collapses;
+        int faceCount = int(faces.size());
+        while (faceCount > targetFaceCount && !heap.empty()) {
+            auto candidate = heap.top();
+            heap.pop();
+            int v = candidate.v, u = candidate.u;
+            if (!alive[v] || !alive[u] || candidate.stampV != stamps[v] || candidate.stampU != stamps[u] || !CanCollapse(v, u)) continue;
+            collapses.push_back(Apply(v, u));
+            faceCount -= int(collapses.back().removedFaces.size());
+            for (int w: Neighbors(u)) {
+                Push(u, w);
+                Push(w, u);
+            }
+        }
+        return collapses;
+    }
+
+    std::vector<std::array<int, 3>> faces;
+    std::vector<char> faceAlive;
+    std::vector<char> alive;
+
+private:
+    void LockBoundaryAndSeams()
+    {
+        // the vertices of edges with a single face
+        std::vector<std::pair<int, int>> edges;
+        for (const auto& face: faces)
+            for (int j = 0; j < 3; j++)
+                edges.emplace_back(std::min(face[j], face[(j + 1) % 3]), std::max(face[j], face[(j + 1) % 3]));
+        std::sort(edges.begin(), edges.end());
+        for (std::size_t i = 0; i < edges.size();) {
+            std::size_t j = i;
+            while (j < edges.size() && edges[j] == edges[i]) j++;
+            if (j - i != 2) locked[edges[i].first] = locked[edges[i].second] = 1; // (boundary or non-manifold)
+            i = j;
+        }
+
+        // the vertices sharing their position with other vertices (split for different normals or texture coordinates)
+        struct PositionHash
+        {
+            std::size_t operator()(const Eigen::Vector3d& p) const
+            {
+                return std::hash<double>()(p.x()) ^ std::hash<double>()(p.y()) * 31 ^ std::hash<double>()(p.z()) * 131;
+            }
+        };
+        std::unordered_map<Eigen::Vector3d, int, PositionHash> positions;
+        positions.reserve(n);
+        for (int v = 0; v < n; v++) {
+            auto [it, isNew] = positions.try_emplace(V.row(v).transpose(), v);
+            if (!isNew) locked[v] = locked[it->second] = 1;
+        }
+    }
+
+    std::vector<int> Neighbors(int v) const
+    {
+        std::vector<int> neighbors;
+        for (int f: vertexFaces[v])
+            for (int w: faces[f])
+                if (w != v) neighbors.push_back(w);
+        std::sort(neighbors.begin(), neighbors.end());
+        neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+        return neighbors;
+    }
+
+    void Push(int v, int u)
+    {
+        if (locked[v]) return;
+        Eigen::Vector4d p;
+        p << V.row(u).transpose(), 1;
+        double cost = p.dot((quadrics[v] + quadrics[u]) * p);
+        heap.push({cost, v, u, stamps[v], stamps[u]});
+    }
+
+    bool CanCollapse(int v, int u) const
+    {
+        // the edge has to have 2 faces, whose opposite vertices are the only common neighbors (the link condition)
+        std::vector<int> opposite;
+        for (int f: vertexFaces[v]) {
+            const auto& face = faces[f];
+            if (face[0] != u && face[1] != u && face[2] != u) continue;
+            for (int w: face)
+                if (w != u && w != v) opposite.push_back(w);
+        }
+        if (opposite.size() != 2 || opposite[0] == opposite[1]) return false;
+        auto neighborsV = Neighbors(v), neighborsU = Neighbors(u);
+        std::vector<int> common;
+        std::set_intersection(neighborsV.begin(), neighborsV.end(), neighborsU.begin(), neighborsU.end(), std::back_inserter(common));
+        if (common.size() != 2) return false;
+
+        // the remaining faces of v mustn't flip or degenerate when v moves to u
+        for (int f: vertexFaces[v]) {
+            const auto& face = faces[f];
+            if (face[0] == u || face[1] == u || face[2] == u) continue;
+            Eigen::Vector3d p[3], q[3];
+            for (int j = 0; j < 3; j++) {
+                p[j] = V.row(face[j]).transpose();
+                q[j] = V.row(face[j] == v ? u : face[j]).transpose();
+            }
+            Eigen::Vector3d before = (p[1] - p[0]).cross(p[2] - p[0]), after = (q[1] - q[0]).cross(q[2] - q[0]);
+            if (after.dot(before) <= 0.2 * before.norm() * after.norm()) return false;
+        }
+        return true;
+    }
+
+    Collapse Apply(int v, int u)
+    {
+        Collapse collapse;
+        collapse.v = v;
+        collapse.u = u;
+        for (int f: vertexFaces[v]) {
+            auto& face = faces[f];
+            if (face[0] == u || face[1] == u || face[2] == u) {
+                collapse.removedFaces.push_back(f);
+                collapse.removedCorners.push_back(face);
+                faceAlive[f] = 0;
+                for (int w: face)
+                    if (w != v) vertexFaces[w].erase(std::find(vertexFaces[w].begin(), vertexFaces[w].end(), f));
+            } else {
+                for (int j = 0; j < 3; j++) {
+                    if (face[j] == v) {
+                        face[j] = u;
+                        collapse.movedCorners.emplace_back(f, j);
+                    }
+                }
+                vertexFaces[u].push_back(f);
+            }
+        }
+        vertexFaces[v].clear();
+        alive[v] = 0;
+        quadrics[u] += quadrics[v];
+        stamps[u]++;
+        return collapse;
+    }
+
+    Eigen::MatrixXd V;
+    int n;
+    std::vector<std::vector<int>> vertexFaces;
+    std::vector<Eigen::Matrix4d, Eigen::aligned_allocator<Eigen::Matrix4d>> quadrics;
+    std::vector<char> locked;
+    std::vector<unsigned int> stamps; // changed when the quadric of a vertex changes (invalidates its candidates)
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<>> heap;
+};
+
+template<typename T>
+bool Read(std::istream& in, T* data, std::size_t count)
+{
+    return bool(in.read(reinterpret_cast<char*>(data), std::streamsize(count * sizeof(T))));
+}
+
+template<typename T>
+void Write(std::ostream& out, const T* data, std::size_t count)
+{
+    out.write(reinterpret_cast<const char*>(data), std::streamsize(count * sizeof(T)));
+}
+
+} // namespace
+
+std::shared_ptr<ProgressiveMesh> ProgressiveMesh::Build(const MeshData& meshData, int targetFaceCount)
+{
+    Simplifier simplifier(meshData);
+    auto collapses = simplifier.Run(targetFaceCount);
+    const int n = int(meshData.GetVertices().rows()), m = int(meshData.GetFaces().rows());
+
+    // the base vertices and faces keep their order, the split vertices and added faces follow in the reverse order of the collapses
+    std::vector<int> vertexOrder(n), faceOrder(m);
+    auto progressiveMesh = std::make_shared<ProgressiveMesh>();
+    int vertexCount = 0, faceCount = 0;
+    for (int v = 0; v < n; v++)
+        if (simplifier.alive[v]) vertexOrder[v] = vertexCount++;
+    for (int f = 0; f < m; f++)
+        if (simplifier.faceAlive[f]) faceOrder[f] = faceCount++;
+    progressiveMesh->baseVertexCount = vertexCount;
+    progressiveMesh->baseFaceCount = faceCount;
+    for (auto collapse = collapses.rbegin(); collapse != collapses.rend(); collapse++) {
+        vertexOrder[collapse->v] = vertexCount++;
+        for (int f: collapse->removedFaces)
+            faceOrder[f] = faceCount++;
+    }
+
+    auto& pm = *progressiveMesh;
+    auto reorder = [&vertexOrder](const MeshData::Matrix& matrix, MeshData::Matrix& reordered) {
+        reordered.resize(matrix.rows(), matrix.cols());
+        for (int v = 0; v < int(matrix.rows()); v++)
+            reordered.row(vertexOrder[v]) = matrix.row(v);
+    };
+    reorder(meshData.GetVertices(), pm.vertices);
+    if (meshData.GetVertexNormals().rows() == n) reorder(meshData.GetVertexNormals(), pm.vertexNormals);
+    if (meshData.GetTextureCoords().rows() == n) reorder(meshData.GetTextureCoords(), pm.textureCoords);
+
+    pm.faces.resize(m, 3);
+    for (int f = 0; f < m; f++)
+        if (simplifier.faceAlive[f])
+            pm.faces.row(faceOrder[f]) << vertexOrder[simplifier.faces[f][0]], vertexOrder[simplifier.faces[f][1]], vertexOrder[simplifier.faces[f][2]];
+    faceCount = pm.baseFaceCount;
+    for (auto collapse = collapses.rbegin(); collapse != collapses.rend(); collapse++) {
+        VertexSplit split;
+        split.parent = vertexOrder[collapse->u];
+        split.firstFace = faceCount;
+        faceCount += int(collapse->removedFaces.size());
+        split.faceCount = int(collapse->removedFaces.size());
+        for (int i = 0; i < split.faceCount; i++) {
+            const auto& corners = collapse->removedCorners[i];
+            pm.faces.row(faceOrder[collapse->removedFaces[i]]) << vertexOrder[corners[0]], vertexOrder[corners[1]], vertexOrder[corners[2]];
+        }
+        for (auto [f, j]: collapse->movedCorners)
+            split.corners.push_back(3 * faceOrder[f] + j);
+        pm.splits.push_back(std::move(split));
+    }
+    pm.availableSplits = int(pm.splits.size());
+
+    debug("progressive mesh of ", m, " faces with a base of ", pm.baseFaceCount, " faces and ", pm.splits.size(), " vertex splits");
+    return progressiveMesh;
+}
+
+MeshData ProgressiveMesh::GetLevel(int level) const
+{
+    level = std::clamp(level, 0, GetAvailableSplitCount());
+    int vertexCount = baseVertexCount + level;
+    int faceCount = level > 0 ? splits[level - 1].firstFace + splits[level - 1].faceCount : baseFaceCount;
+
+    MeshData::IndexMatrix F = faces.topRows(faceCount);
+    for (int s = 0; s < level; s++)
+        for (int corner: splits[s].corners)
+            F(corner / 3, corner % 3) = baseVertexCount + s;
+
+    auto attribute = [vertexCount](const MeshData::Matrix& matrix, int cols) {
+        return matrix.rows() > 0 ? MeshData::Matrix(matrix.topRows(vertexCount)) : MeshData::Matrix(MeshData::Matrix::Zero(vertexCount, cols));
+    };
+    return {vertices.topRows(vertexCount), std::move(F), attribute(vertexNormals, 3), attribute(textureCoords, 2)};
+}
+
+bool ProgressiveMesh::Save(const std::string& file) const
+{
+    if (!IsComplete()) return false;
+    std::ofstream out(file, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+
+    FileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.flags = (vertexNormals.rows() > 0 ? HAS_NORMALS : 0) | (textureCoords.rows() > 0 ? HAS_TEXTURE_COORDS : 0);
+    header.vertexCount = int(vertices.rows());
+    header.faceCount = int(faces.rows());
+    header.baseVertexCount = baseVertexCount;
+    header.baseFaceCount = baseFaceCount;
+    header.splitCount = int(splits.size());
+    Write(out, &header, 1);
+
+    auto writeVertices = [&](int first, int count) {
+        Write(out, vertices.row(first).data(), 3 * std::size_t(count));
+        if (header.flags & HAS_NORMALS) Write(out, vertexNormals.row(first).data(), 3 * std::size_t(count));
+        if (header.flags & HAS_TEXTURE_COORDS) Write(out, textureCoords.row(first).data(), 2 * std::size_t(count));
+    };
+    if (baseVertexCount > 0) writeVertices(0, baseVertexCount);
+    if (baseFaceCount > 0) Write(out, faces.data(), 3 * std::size_t(baseFaceCount));
+
+    for (int s = 0; s < int(splits.size()); s++) {
+        const auto& split = splits[s];
+        SplitHeader splitHeader{split.parent, split.faceCount, int(split.corners.size())};
+        Write(out, &splitHeader, 1);
+        writeVertices(baseVertexCount + s, 1);
+        if (split.faceCount > 0) Write(out, faces.row(split.firstFace).data(), 3 * std::size_t(split.faceCount));
+        Write(out, split.corners.data(), split.corners.size());
+    }
+    return bool(out);
+}
+
+std::shared_ptr<ProgressiveMesh> ProgressiveMesh::Load(const std::string& file)
+{
+    auto in = std::make_shared<std::ifstream>(file, std::ios::binary);
+    FileHeader header{};
+    if (!*in || !Read(*in, &header, 1) || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION
+        || header.baseVertexCount < 0 || header.baseFaceCount < 0 || header.splitCount < 0
+        || header.vertexCount != header.baseVertexCount + header.splitCount || header.faceCount < header.baseFaceCount)
+        return nullptr;
+
+    auto progressiveMesh = std::make_shared<ProgressiveMesh>();
+    auto& pm = *progressiveMesh;
+    pm.baseVertexCount = header.baseVertexCount;
+    pm.baseFaceCount = header.baseFaceCount;
+    pm.vertices.resize(header.vertexCount, 3);
+    if (header.flags & HAS_NORMALS) pm.vertexNormals.resize(header.vertexCount, 3);
+    if (header.flags & HAS_TEXTURE_COORDS) pm.textureCoords.resize(header.vertexCount, 2);
+    pm.faces.resize(header.faceCount, 3);
+    pm.splits.resize(header.splitCount);
+
+    auto readVertices = [mesh = progressiveMesh.get(), flags = header.flags](std::istream& in, int first, int count) {
+        return Read(in, mesh->vertices.row(first).data(), 3 * std::size_t(count))
+               && (!(flags & HAS_NORMALS) || Read(in, mesh->vertexNormals.row(first).data(), 3 * std::size_t(count)))
+               && (!(flags & HAS_TEXTURE_COORDS) || Read(in, mesh->textureCoords.row(first).data(), 2 * std::size_t(count)));
+    };
+    if ((pm.baseVertexCount > 0 && !readVertices(*in, 0, pm.baseVertexCount))
+        || (pm.baseFaceCount > 0 && !Read(*in, pm.faces.data(), 3 * std::size_t(pm.baseFaceCount))))
+        return nullptr;
+    if (pm.baseFaceCount > 0 && (pm.faces.topRows(pm.baseFaceCount).minCoeff() < 0 || pm.faces.topRows(pm.baseFaceCount).maxCoeff() >= pm.baseVertexCount)) {
+        debug("progressive mesh file ", file, " has invalid base faces");
+        return nullptr;
+    }
+
+    // read the splits in the background (the pending task keeps the mesh alive)
+    if (header.splitCount > 0) {
+        ThreadPool::Global().Submit([progressiveMesh, in, readVertices, file]() {
+            auto& pm = *progressiveMesh;
+            int faceCount = pm.baseFaceCount;
+            for (int s = 0; s < int(pm.splits.size()); s++) {
+                SplitHeader splitHeader{};
+                auto& split = pm.splits[s];
+                bool valid = Read(*in, &splitHeader, 1) && splitHeader.faceCount >= 0 && splitHeader.cornerCount >= 0
+                             && splitHeader.faceCount <= pm.faces.rows() - faceCount && readVertices(*in, pm.baseVertexCount + s, 1);
+                if (valid) {
+                    split.parent = splitHeader.parent;
+                    split.firstFace = faceCount;
+                    split.faceCount = splitHeader.faceCount;
+                    split.corners.resize(splitHeader.cornerCount);
+                    valid = (split.faceCount == 0 || Read(*in, pm.faces.row(faceCount).data(), 3 * std::size_t(split.faceCount)))
+                            && Read(*in, split.corners.data(), split.corners.size());
+                    faceCount += split.faceCount;
+                    // (the indices may only refer to what exists at this level)
+                    int vertexCount = pm.baseVertexCount + s + 1;
+                    valid = valid && split.parent >= 0 && split.parent < vertexCount - 1
+                            && (split.faceCount == 0 || (pm.faces.middleRows(split.firstFace, split.faceCount).minCoeff() >= 0
+                                                         && pm.faces.middleRows(split.firstFace, split.faceCount).maxCoeff() < vertexCount))
+                            && std::all_of(split.corners.begin(), split.corners.end(), [faceCount](int corner) { return corner >= 0 && corner < 3 * faceCount; });
+                }
+                if (!valid) {
+                    debug("progressive mesh file ", file, " is truncated after ", s, " splits");
+                    pm.availableSplits.store(s, std::memory_order_release);
+                    break;
+                }
+                if ((s + 1) % PUBLISH_INTERVAL == 0 || s + 1 == int(pm.splits.size()))
+                    pm.availableSplits.store(s + 1, std::memory_order_release);
+            }
+        });
+    }
+
+    return progressiveMesh;
+}
+
+} // namespace cg3d
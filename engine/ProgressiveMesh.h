@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Mesh.h"
+
+
+namespace cg3d
+{
+
+/**
+    A mesh stored as a coarse base mesh and a sequence of vertex splits refining it back to the full mesh (Hoppe's
+    progressive meshes). Build records half-edge collapses in the order of their quadric error and reverses them into splits.
+    The vertices and faces are ordered by the level they appear at: the mesh refined by the first L splits is made of the first
+    baseVertexCount + L vertices and the faces of the base and the first L splits, with some face corners moved to the split vertices.
+    A progressive mesh file is read the same way: the base mesh first, then the splits in the background as they arrive (see Load).
+**/
+class ProgressiveMesh
+{
+public:
+    struct VertexSplit
+    {
+        int parent = 0; // the vertex the split vertex was collapsed into (the split vertex is baseVertexCount + the split index)
+        int firstFace = 0, faceCount = 0; // the faces the split adds
+        std::vector<int> corners; // the corners (3 * face + corner) of existing faces that move from the parent to the split vertex
+    };
+
+    MeshData::Matrix vertices, vertexNormals, textureCoords; // all the vertices, in level order
+    MeshData::IndexMatrix faces; // all the faces, in level order, with the corners they have when they're added
+    int baseVertexCount = 0, baseFaceCount = 0;
+    std::vector<VertexSplit> splits;
+
+    /**
+        @brief Make the progressive mesh of a mesh (boundary vertices and vertices at attribute seams are kept in the base mesh)
+        @param meshData        - the full mesh
+        @param targetFaceCount - collapse until the base mesh has this many faces (or until nothing can collapse)
+    **/
+    static std::shared_ptr<ProgressiveMesh> Build(const MeshData& meshData, int targetFaceCount = 0);
+
+    // read the base mesh of a file and the splits in the background on the thread pool (null if the file can't be read)
+    static std::shared_ptr<ProgressiveMesh> Load(const std::string& file);
+    bool Save(const std::string& file) const; // (with all the splits available)
+
+    [[nodiscard]] inline int GetAvailableSplitCount() const { return availableSplits.load(std::memory_order_acquire); }
+    [[nodiscard]] inline bool IsComplete() const { return GetAvailableSplitCount() == int(splits.size()); }
+
+    // the mesh refined by the first level splits (at most the available ones)
+    [[nodiscard]] MeshData GetLevel(int level) const;
+
+private:
+    std::atomic<int> availableSplits{0}; // the splits that were read (the ones below it are safe to use while the rest are read)
+};
+
+} // namespace cg3d
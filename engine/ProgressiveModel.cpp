@@ -0,0 +1,65 @@
+#include "ProgressiveModel.h"
+
+#include <algorithm>
+#include <utility>
+
+
+namespace cg3d
+{
+
+ProgressiveModel::ProgressiveModel(std::string name, std::shared_ptr<ProgressiveMesh> _progressiveMesh, std::shared_ptr<Material> material)
+        : Movable{name}, Model{name, {std::make_shared<Mesh>(name + "_mesh", std::vector<MeshData>{_progressiveMesh->GetLevel(0)})}, std::move(material)},
+          progressiveMesh(std::move(_progressiveMesh)) {}
+
+std::shared_ptr<ProgressiveModel> ProgressiveModel::Create(std::string name, std::shared_ptr<ProgressiveMesh> progressiveMesh,
+                                                           std::shared_ptr<Material> material, const std::shared_ptr<Movable>& parent)
+{
+    auto model = std::shared_ptr<ProgressiveModel>(new ProgressiveModel(std::move(name), std::move(progressiveMesh), std::move(material)));
+    model->SetParent(parent);
+    return model;
+}
+
+void ProgressiveModel::Accept(Visitor* visitor)
+{
+    int available = progressiveMesh->GetAvailableSplitCount();
+    int newLevel = std::clamp(targetLevel, 0, available);
+    if (newLevel != level) {
+        auto& meshData = GetMeshList()[0]->data[0];
+        const auto& splits = progressiveMesh->splits;
+        auto faceCount = [&](int level) { return level > 0 ? splits[level - 1].firstFace + splits[level - 1].faceCount : progressiveMesh->baseFaceCount; };
+        bool complete = newLevel == std::min(targetLevel, int(splits.size()));
+        if (newLevel < level) {
+            auto coarse = progressiveMesh->GetLevel(newLevel); // (edited in place so the change counters of the mesh data go on)
+            meshData.EditVertices() = coarse.GetVertices();
+            meshData.EditFaces() = coarse.GetFaces();
+            meshData.EditVertexNormals() = coarse.GetVertexNormals();
+            meshData.EditTextureCoords() = coarse.GetTextureCoords();
+            level = newLevel;
+        } else if (complete || float(faceCount(newLevel) - faceCount(level)) >= minGrowth * float(faceCount(level))) {
+            // apply the new splits to the shown mesh (the added vertices and faces are the next rows of the progressive mesh)
+            int vertexCount = progressiveMesh->baseVertexCount + newLevel, newFaceCount = faceCount(newLevel), oldFaceCount = faceCount(level);
+            auto grow = [vertexCount](MeshData::Matrix& matrix, const MeshData::Matrix& all) {
+                int oldRows = int(matrix.rows());
+                matrix.conservativeResize(vertexCount, matrix.cols());
+                if (all.rows() > 0)
+                    matrix.bottomRows(vertexCount - oldRows) = all.middleRows(oldRows, vertexCount - oldRows);
+                else
+                    matrix.bottomRows(vertexCount - oldRows).setZero();
+            };
+            grow(meshData.EditVertices(), progressiveMesh->vertices);
+            grow(meshData.EditVertexNormals(), progressiveMesh->vertexNormals);
+            grow(meshData.EditTextureCoords(), progressiveMesh->textureCoords);
+            auto& F = meshData.EditFaces();
+            F.conservativeResize(newFaceCount, 3);
+            F.bottomRows(newFaceCount - oldFaceCount) = progressiveMesh->faces.middleRows(oldFaceCount, newFaceCount - oldFaceCount);
+            for (int s = level; s < newLevel; s++)
+                for (int corner: splits[s].corners)
+                    F(corner / 3, corner % 3) = progressiveMesh->baseVertexCount + s;
+            level = newLevel;
+        }
+    }
+
+    Model::Accept(visitor);
+}
+
+} // namespace cg3d
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <limits>
+#include "Model.h"
+#include "ProgressiveMesh.h"
+
+
+namespace cg3d
+{
+
+// a model showing a progressive mesh, drawn at once at its base level and refined as its vertex splits become available
+// (e.g. while the rest of a progressive mesh file is read in the background, see ProgressiveMesh::Load)
+class ProgressiveModel : public Model
+{
+    ProgressiveModel(std::string name, std::shared_ptr<ProgressiveMesh> progressiveMesh, std::shared_ptr<Material> material);
+
+public:
+    static std::shared_ptr<ProgressiveModel> Create(std::string name, std::shared_ptr<ProgressiveMesh> progressiveMesh,
+                                                    std::shared_ptr<Material> material, const std::shared_ptr<Movable>& parent = nullptr);
+
+    void Accept(Visitor* visitor) override; // refines (or coarsens) the mesh toward targetLevel before it's drawn
+
+    int targetLevel = std::numeric_limits<int>::max(); // the number of splits to show (the full mesh by default)
+    float minGrowth = 0.25f; // refine only when the available splits add this fraction of the shown faces (each refinement updates the whole mesh)
+
+    [[nodiscard]] inline int GetLevel() const { return level; }
+    [[nodiscard]] inline const std::shared_ptr<ProgressiveMesh>& GetProgressiveMesh() const { return progressiveMesh; }
+
+private:
+    std::shared_ptr<ProgressiveMesh> progressiveMesh;
+    int level = 0;
+};
+
+} // namespace cg3d
@@ -1,6 +1,7 @@
 #include "Renderer.h"
 #include "Debug.h"
 #include "DrawVisitor.h"
+#include "IdBufferVisitor.h"
 #include "Scene.h"
 #include "GLFW/glfw3.h"
 
@@ -22,11 +23,15 @@ Viewport* Renderer::FindViewportAtPos(int x, int y)
 
 void Renderer::RunVisitorOnViewport(Viewport* viewport, Visitor* visitor)
 {
+    bool isDrawing = !visitor;
     if (!visitor)
         visitor = viewport->visitor.get();
 
     viewport->Bind();
     visitor->Run(viewport->camera.get());
+
+    if (isDrawing && viewport->idBufferVisitor)
+        viewport->idBufferVisitor->Run(viewport->camera.get());
 }
 
 void Renderer::RunVisitorOnViewportAtPos(int x, int y, Visitor* visitor)
@@ -8,6 +8,8 @@
 namespace cg3d
 {
 
+class FrameCapture;
+
 class Renderer
 {
 public:
@@ -29,6 +31,8 @@ public:
     [[nodiscard]] inline int GetWindowWidth() const { return windowWidth; }
     [[nodiscard]] inline int GetWindowHeight() const { return windowHeight; };
 
+    std::shared_ptr<FrameCapture> frameCapture; // when set, the frames drawn by Display::LaunchRendering are captured with it
+
 private:
     Viewport* FindViewportAtPos(int x, int y);
 
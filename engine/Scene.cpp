@@ -1,10 +1,13 @@
 #include "Scene.h"
 
+#include <algorithm>
 #include <utility>
 #include "Camera.h"
 #include "PickVisitor.h"
+#include "IdBufferVisitor.h"
 #include "Renderer.h"
 #include "GLFW/glfw3.h"
+#include "unproject_ray.h"
 #include "debug.h"
 
 
@@ -23,11 +26,157 @@ void Scene::Init(Visitor* visitor)
 
 void Scene::Accept(Visitor* visitor)
 {
+    spatialIndex->Update();
+
     Movable::Accept(visitor);
 
     visitor->Visit(this);
 }
 
+std::vector<Model*> Scene::QueryFrustum(const Eigen::Matrix4f& viewProj) const
+{
+    std::vector<Model*> models;
+    spatialIndex->QueryFrustum(viewProj, [&models](void* userData) {
+        models.push_back(static_cast<Model*>(userData));
+        return true;
+    });
+    return models;
+}
+
+std::vector<Model*> Scene::QueryBox(const Eigen::AlignedBox3f& box) const
+{
+    std::vector<Model*> models;
+    spatialIndex->QueryBox(box, [&models](void* userData) {
+        models.push_back(static_cast<Model*>(userData));
+        return true;
+    });
+    return models;
+}
+
+std::vector<std::pair<Model*, float>> Scene::QueryRay(const Eigen::Vector3f& origin, const Eigen::Vector3f& direction, float maxDistance) const
+{
+    std::vector<std::pair<Model*, float>> hits;
+    spatialIndex->QueryRay(origin, direction, maxDistance, [&hits](void* userData, float distance) {
+        hits.emplace_back(static_cast<Model*>(userData), distance);
+        return true;
+    });
+    std::sort(hits.begin(), hits.end(), [](const auto& a, const auto& b) { return a.second < b.second; });
+    return hits;
+}
+
+Model* Scene::QueryNearest(const Eigen::Vector3f& point, float maxDistance) const
+{
+    return static_cast<Model*>(spatialIndex->QueryNearest(point, maxDistance));
+}
+
+RayHit Scene::PickRay(Viewport* viewport, int x, int y)
+{
+    RayHit hit;
+    if (!viewport || !viewport->camera) return hit;
+
+    // the ray in the space the models are drawn in (the same matrices the visitors use)
+    const Eigen::Matrix4f& proj = viewport->camera->GetViewProjection();
+    Eigen::Matrix4f view = viewport->camera->GetAggregatedTransform().inverse();
+    Eigen::Vector2f pos(float(x), float(renderer->GetWindowHeight() - y));
+    Eigen::Vector4f viewportVec(float(viewport->x), float(viewport->y), float(viewport->width), float(viewport->height));
+    Eigen::Vector3f origin, direction; // from the near plane (t = 0) to the far plane (t = 1)
+    igl::unproject_ray(pos, view, proj, viewportVec, origin, direction);
+
+    // the spatial index holds the models in the space of their aggregated transforms, which for non-static
+    // models is the space of the scene (the scene transform is applied on top of them when drawing)
+    Eigen::Matrix4f sceneInverse = aggregatedTransform.inverse();
+    Eigen::Vector3f sceneOrigin = sceneInverse.block<3, 3>(0, 0) * origin + sceneInverse.block<3, 1>(0, 3);
+    Eigen::Vector3f sceneDirection = sceneInverse.block<3, 3>(0, 0) * direction;
+
+    std::vector<std::pair<Model*, float>> candidates;
+    spatialIndex->QueryRay(sceneOrigin, sceneDirection, 1, [&candidates](void* userData, float distance) {
+        auto model = static_cast<Model*>(userData);
+        if (!model->isStatic) candidates.emplace_back(model, distance);
+        return true;
+    });
+    spatialIndex->QueryRay(origin, direction, 1, [&candidates](void* userData, float distance) {
+        auto model = static_cast<Model*>(userData);
+        if (model->isStatic) candidates.emplace_back(model, distance);
+        return true;
+    });
+    std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) { return a.second < b.second; });
+
+    for (auto& [model, distance]: candidates) {
+        if (distance > hit.t) break; // the bounding boxes of the rest are all further than the closest hit
+        if (model->isHidden) continue;
+        model->IntersectRay(PickTransform(model), origin, direction, hit);
+    }
+
+    if (hit.model) {
+        Eigen::Vector4f clip = proj * view * hit.position.homogeneous();
+        hit.depth = clip.z() / clip.w() * 0.5f + 0.5f;
+    }
+
+    return hit;
+}
+
+PrimitiveHit Scene::PickPrimitive(Viewport* viewport, int x, int y, PrimitiveType type)
+{
+    auto hit = PickRay(viewport, x, y);
+    return hit.model ? hit.model->SnapToPrimitive(hit, type, PickTransform(hit.model)) : PrimitiveHit{hit, type};
+}
+
+Eigen::Vector2f Scene::WindowToViewport(Viewport* viewport, int x, int y) const
+{
+    return {2.0f * float(x - viewport->x) / float(viewport->width) - 1,
+            2.0f * float(renderer->GetWindowHeight() - y - viewport->y) / float(viewport->height) - 1};
+}
+
+std::vector<Model*> Scene::SelectModels(Viewport* viewport, const ScreenRegion& region) const
+{
+    std::vector<Model*> selected;
+    if (!viewport || !viewport->camera || region.GetBounds().isEmpty()) return selected;
+
+    // query the spatial index with the frustum of the region bounds (the non-static models are in the scene space)
+    Eigen::Matrix4f viewProj = viewport->camera->GetViewProjection() * viewport->camera->GetAggregatedTransform().inverse();
+    Eigen::Matrix4f regionFrustum = region.PickMatrix() * viewProj;
+    auto select = [&](bool isStatic, const Eigen::Matrix4f& transform) {
+        spatialIndex->QueryFrustum(regionFrustum * transform, [&](void* userData) {
+            auto model = static_cast<Model*>(userData);
+            if (model->isStatic == isStatic && !model->isHidden &&
+                region.ContainsProjected(viewProj * transform * model->GetWorldBounds().center().homogeneous()))
+                selected.push_back(model);
+            return true;
+        });
+    };
+    select(false, aggregatedTransform);
+    select(true, Eigen::Matrix4f::Identity());
+
+    return selected;
+}
+
+std::vector<Model*> Scene::SelectRect(Viewport* viewport, int x0, int y0, int x1, int y1) const
+{
+    return SelectModels(viewport, ScreenRegion::Rect(WindowToViewport(viewport, x0, y0), WindowToViewport(viewport, x1, y1)));
+}
+
+std::vector<Model*> Scene::SelectLasso(Viewport* viewport, const std::vector<Eigen::Vector2i>& points) const
+{
+    std::vector<Eigen::Vector2f> polygon;
+    polygon.reserve(points.size());
+    for (const auto& point: points)
+        polygon.emplace_back(WindowToViewport(viewport, point.x(), point.y()));
+    return SelectModels(viewport, ScreenRegion::Lasso(std::move(polygon)));
+}
+
+std::vector<int> Scene::SelectPrimitives(Viewport* viewport, const ScreenRegion& region, Model* model, PrimitiveType type, int mesh) const
+{
+    if (!viewport || !viewport->camera || region.GetBounds().isEmpty()) return {};
+
+    Eigen::Matrix4f clipMatrix = viewport->camera->GetViewProjection() * viewport->camera->GetAggregatedTransform().inverse() * PickTransform(model);
+    return model->SelectPrimitives(region, clipMatrix, type, mesh);
+}
+
+Eigen::Matrix4f Scene::PickTransform(const Model* model) const
+{
+    return model->isStatic ? model->aggregatedTransform : Eigen::Matrix4f(aggregatedTransform * model->aggregatedTransform);
+}
+
 void Scene::Update(const Program& program, const Eigen::Matrix4f& proj, const Eigen::Matrix4f& view, const Eigen::Matrix4f& model)
 {
     program.SetUniformMatrix4f("Proj", &proj);
@@ -40,10 +189,19 @@ void Scene::MouseCallback(Viewport* viewport, int x, int y, int button, int acti
     // note: there's a (small) chance the button state here precedes the mouse press/release event
 
     if (action == GLFW_PRESS) { // default mouse button press behavior
-        PickVisitor visitor(this);
-        renderer->RunVisitorOnViewportAtPos(x, y, &visitor); // pick using fixed colors hack
-        auto modelAndDepth = visitor.PickAtPos(x, renderer->GetWindowHeight() - y);
-        renderer->RunVisitorOnViewportAtPos(x, y); // draw again to avoid flickering
+        std::pair<Model*, float> modelAndDepth;
+        auto& idBufferVisitor = viewport->idBufferVisitor;
+        if (pickMode == PickMode::IdBuffer && idBufferVisitor && idBufferVisitor->HasPickResult()) {
+            modelAndDepth = {idBufferVisitor->GetPickedModel().get(), idBufferVisitor->GetPickedDepth()};
+        } else if (pickMode != PickMode::Color) {
+            auto hit = PickRay(viewport, x, y);
+            modelAndDepth = {hit.model, hit.depth};
+        } else {
+            PickVisitor visitor(this);
+            renderer->RunVisitorOnViewportAtPos(x, y, &visitor); // pick using fixed colors hack
+            modelAndDepth = visitor.PickAtPos(x, renderer->GetWindowHeight() - y);
+            renderer->RunVisitorOnViewportAtPos(x, y); // draw again to avoid flickering
+        }
         pickedModel = modelAndDepth.first ? std::dynamic_pointer_cast<Model>(modelAndDepth.first->shared_from_this()) : nullptr;
         pickedModelDepth = modelAndDepth.second;
         camera->GetRotation().transpose();
@@ -81,6 +239,9 @@ void Scene::ScrollCallback(Viewport* viewport, int x, int y, int xoffset, int yo
 
 void Scene::CursorPosCallback(Viewport* viewport, int x, int y, bool dragging, int* buttonState)
 {
+    if (viewport->idBufferVisitor)
+        viewport->idBufferVisitor->SetPickPosition(x, renderer->GetWindowHeight() - y);
+
     if (dragging) {
         auto system = camera->GetRotation().transpose();
         auto moveCoeff = camera->CalcMoveCoeff(pickedModelDepth, viewport->width);
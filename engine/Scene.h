@@ -8,6 +8,7 @@
 #include "Model.h"
 #include "Viewport.h"
 #include "Display.h"
+#include "AabbTree.h"
 #include <Eigen/Core>
 
 #include <Eigen/Geometry>
@@ -16,6 +17,7 @@
 #include <vector>
 #include <string>
 #include <cstdint>
+#include <limits>
 
 #include "glfw/Viewer.h"
 
@@ -37,6 +39,32 @@ public:
     void Accept(Visitor* visitor) override;
     std::shared_ptr<Model> pickedModel = nullptr;
     std::shared_ptr<Camera> camera;
+    bool cameraRelativeRendering = false; // draw relative to the camera position (for scenes far from the origin)
+    std::shared_ptr<AabbTree> spatialIndex = std::make_shared<AabbTree>(); // world bounds of the models in the scene
+
+    // spatial queries over the models in the scene (in the space of the aggregated transforms)
+    std::vector<Model*> QueryFrustum(const Eigen::Matrix4f& viewProj) const;
+    std::vector<Model*> QueryBox(const Eigen::AlignedBox3f& box) const;
+    std::vector<std::pair<Model*, float>> QueryRay(const Eigen::Vector3f& origin, const Eigen::Vector3f& direction,
+                                                   float maxDistance = std::numeric_limits<float>::infinity()) const; // sorted by distance
+    Model* QueryNearest(const Eigen::Vector3f& point, float maxDistance = std::numeric_limits<float>::infinity()) const;
+
+    enum class PickMode
+    {
+        Ray, // intersect the meshes on the CPU (no rendering or GPU round trip)
+        Color, // render the models with unique colors and read back the pixel under the cursor
+        IdBuffer // use the latest asynchronous result of the id buffer of the viewport (falls back to Ray without one)
+    };
+    PickMode pickMode = PickMode::Ray;
+    RayHit PickRay(Viewport* viewport, int x, int y); // x, y are window coordinates (y goes downwards)
+    PrimitiveHit PickPrimitive(Viewport* viewport, int x, int y, PrimitiveType type); // the face, or the vertex or edge closest to the hit
+
+    // multi-selection by a rectangle or a lasso (a model is selected when the center of its bounds is inside the region)
+    Eigen::Vector2f WindowToViewport(Viewport* viewport, int x, int y) const; // window coordinates to normalized device coordinates
+    std::vector<Model*> SelectModels(Viewport* viewport, const ScreenRegion& region) const;
+    std::vector<Model*> SelectRect(Viewport* viewport, int x0, int y0, int x1, int y1) const; // corners in window coordinates
+    std::vector<Model*> SelectLasso(Viewport* viewport, const std::vector<Eigen::Vector2i>& points) const; // window coordinates
+    std::vector<int> SelectPrimitives(Viewport* viewport, const ScreenRegion& region, Model* model, PrimitiveType type, int mesh = 0) const;
 
     virtual void MouseCallback(Viewport* viewport, int x, int y, int button, int action, int mods, int buttonState[]);
     virtual void ScrollCallback(Viewport* viewport, int x, int y, int xoffset, int yoffset, bool dragging, int buttonState[]);
@@ -47,10 +75,11 @@ public:
     virtual void AddViewportCallback(Viewport* viewport) {};
 
 protected:
+    [[nodiscard]] Eigen::Matrix4f PickTransform(const Model* model) const; // the transformation of the model in the space picking rays are in
     Renderer* renderer; // required for picking
     int xAtPress = -1, yAtPress = -1;
     float pickedModelDepth = 0;
-    Eigen::Affine3f pickedToutAtPress, cameraToutAtPress;
+    Trs pickedToutAtPress, cameraToutAtPress;
 };
 
 } // namespace cg3d
@@ -0,0 +1,486 @@
+#include "SceneSnapshot.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include "Camera.h"
+#include "MappedFile.h"
+#include "Material.h"
+#include "Mesh.h"
+#include "Model.h"
+#include "Movable.h"
+#include "ThreadPool.h"
+#include "Debug.h"
+
+
+namespace cg3d
+{
+
+namespace
+{
+
+constexpr char MAGIC[8] = {'C', 'G', '3', 'D', 'S', 'C', 'N', '\0'};
+constexpr std::uint64_t TABLE_ALIGNMENT = 8, BLOCK_ALIGNMENT = 64;
+
+enum class NodeType : std::uint32_t
+{
+    MOVABLE, CAMERA, MODEL
+};
+
+enum NodeFlags : std::uint32_t
+{
+    PICKABLE = 1 << 0,
+    STATIC = 1 << 1,
+    SHOW_FACES = 1 << 2,
+    SHOW_TEXTURES = 1 << 3,
+    SHOW_WIREFRAME = 1 << 4,
+    HIDDEN = 1 << 5,
+    CULL_CLUSTERS = 1 << 6,
+    CULL_BACK_CLUSTERS = 1 << 7
+};
+
+enum Table
+{
+    NODES, MESHES, DATA, MATERIALS, MESH_REFERENCES, STRINGS, TABLE_COUNT
+};
+
+struct FileHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t reserved;
+    std::uint64_t counts[TABLE_COUNT]; // of the records of each table (bytes of the strings)
+    std::uint64_t offsets[TABLE_COUNT];
+};
+
+struct StringRecord // (in the strings table)
+{
+    std::uint32_t offset, length;
+};
+
+struct TrsRecord
+{
+    double translation[3];
+    float rotation[4]; // (x, y, z, w)
+    float scale[3];
+    float reserved;
+};
+
+struct NodeRecord
+{
+    NodeType type;
+    std::uint32_t flags;
+    std::uint32_t subtreeSize; // the node and its descendants, which follow it
+    StringRecord name;
+    std::int32_t material; // (-1 for none)
+    std::uint32_t firstMesh, meshCount; // in the mesh references table
+    std::int32_t meshIndex;
+    float lineWidth;
+    float wireframeColor[4];
+    TrsRecord tin, tout;
+    double camera[5]; // fov, ratio, near, far, length
+};
+
+struct MeshRecord
+{
+    StringRecord name;
+    std::uint32_t firstData, dataCount; // in the data table
+};
+
+struct DataRecord // (as in the mesh cache files, see MeshCache)
+{
+    std::uint32_t vertexCount, faceCount, normalCount, uvCount;
+    std::uint64_t offsets[4]; // of the vertices, faces, normals and texture coordinates blocks
+};
+
+constexpr std::size_t RECORD_SIZES[TABLE_COUNT]{sizeof(NodeRecord), sizeof(MeshRecord), sizeof(DataRecord), sizeof(StringRecord), sizeof(std::uint32_t), 1};
+
+static_assert(std::is_trivially_copyable_v<NodeRecord> && std::is_trivially_copyable_v<DataRecord>);
+
+std::uint32_t Flag(bool isSet, NodeFlags flag) { return isSet ? std::uint32_t(flag) : std::uint32_t(0); }
+
+std::uint64_t Align(std::uint64_t value, std::uint64_t alignment) { return (value + alignment - 1) / alignment * alignment; }
+
+TrsRecord ToRecord(const Trs& trs)
+{
+    return {{trs.translation.x(), trs.translation.y(), trs.translation.z()},
+            {trs.rotation.x(), trs.rotation.y(), trs.rotation.z(), trs.rotation.w()},
+            {trs.scale.x(), trs.scale.y(), trs.scale.z()}, 0};
+}
+
+Trs FromRecord(const TrsRecord& record)
+{
+    Trs trs;
+    trs.translation = {record.translation[0], record.translation[1], record.translation[2]};
+    trs.rotation = Eigen::Quaternionf(record.rotation[3], record.rotation[0], record.rotation[1], record.rotation[2]);
+    trs.scale = {record.scale[0], record.scale[1], record.scale[2]};
+    return trs;
+}
+
+// a mapped snapshot file with its tables, validated when opened
+class SnapshotFile
+{
+public:
+    explicit SnapshotFile(const std::string& file) : mappedFile(file) { isValid = Validate(); }
+
+    [[nodiscard]] bool IsValid() const { return isValid; }
+
+    // the node at a path of names (-1 if there's none)
+    [[nodiscard]] int Find(const std::string& path) const
+    {
+        int node = 0;
+        for (std::size_t begin = 0; begin < path.size();) {
+            std::size_t end = std::min(path.find('/', begin), path.size());
+            if (end > begin) {
+                std::string_view name(path.data() + begin, end - begin);
+                int child = node + 1;
+                while (child < node + int(nodes[node].subtreeSize) && GetString(nodes[child].name) != name)
+                    child += int(nodes[child].subtreeSize);
+                if (child >= node + int(nodes[node].subtreeSize)) return -1;
+                node = child;
+            }
+            begin = end + 1;
+        }
+        return node;
+    }
+
+    [[nodiscard]] int GetSubtreeEnd(int node) const { return node + int(nodes[node].subtreeSize); }
+
+    // create the nodes of a range of sub-trees, returning their roots (null if the mesh data is invalid)
+    std::vector<std::shared_ptr<Movable>> LoadNodes(int first, int last, const SceneSnapshot::MaterialResolver& resolveMaterial)
+    {
+        // the meshes of the models in the range, copied from their blocks in parallel
+        std::vector<std::shared_ptr<Mesh>> meshes(meshRecords.size());
+        std::vector<std::uint32_t> usedMeshes;
+        std::vector<bool> isUsed(meshRecords.size());
+        for (int i = first; i < last; i++)
+            for (std::uint32_t r = nodes[i].firstMesh; r < nodes[i].firstMesh + nodes[i].meshCount; r++)
+                if (!isUsed[meshReferences[r]]) {
+                    isUsed[meshReferences[r]] = true;
+                    usedMeshes.push_back(meshReferences[r]);
+                }
+        std::atomic<bool> areMeshesValid = true;
+        ThreadPool::Global().ParallelFor(0, int(usedMeshes.size()), 1, [&](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                const auto& record = meshRecords[usedMeshes[i]];
+                std::vector<MeshData> dataList;
+                for (std::uint32_t d = record.firstData; d < record.firstData + record.dataCount; d++) {
+                    const auto& data = dataRecords[d];
+                    MeshData::Matrix V, V_normals, V_uv;
+                    MeshData::IndexMatrix F;
+                    if (!ReadBlock(data.offsets[0], data.vertexCount, 3, V) || !ReadBlock(data.offsets[1], data.faceCount, 3, F)
+                        || !ReadBlock(data.offsets[2], data.normalCount, 3, V_normals) || !ReadBlock(data.offsets[3], data.uvCount, 2, V_uv)
+                        || (F.size() > 0 && (F.minCoeff() < 0 || F.maxCoeff() >= V.rows()))) {
+                        areMeshesValid = false;
+                        return;
+                    }
+                    dataList.emplace_back(std::move(V), std::move(F), std::move(V_normals), std::move(V_uv));
+                }
+                meshes[usedMeshes[i]] = std::make_shared<Mesh>(std::string(GetString(record.name)), std::move(dataList));
+            }
+        });
+        if (!areMeshesValid) return {};
+
+        // the nodes, linked to their parents while they're detached (so nothing is propagated or searched per node)
+        std::vector<std::shared_ptr<Material>> materials(materialRecords.size());
+        std::vector<bool> isResolved(materialRecords.size());
+        std::vector<std::shared_ptr<Movable>> roots;
+        std::vector<std::pair<int, Movable*>> ancestors; // (the end of the sub-tree of each)
+        for (int i = first; i < last; i++) {
+            const auto& record = nodes[i];
+            while (!ancestors.empty() && ancestors.back().first <= i)
+                ancestors.pop_back();
+
+            std::string name(GetString(record.name));
+            std::shared_ptr<Movable> node;
+            if (record.type == NodeType::MODEL && record.material >= 0) {
+                if (!isResolved[record.material]) {
+                    materials[record.material] = resolveMaterial(std::string(GetString(materialRecords[record.material])));
+                    isResolved[record.material] = true;
+                    if (!materials[record.material])
+                        debug("no material ", GetString(materialRecords[record.material]), ", loading its models as plain nodes");
+                }
+                if (materials[record.material]) {
+                    std::vector<std::shared_ptr<Mesh>> meshList;
+                    for (std::uint32_t r = record.firstMesh; r < record.firstMesh + record.meshCount; r++)
+                        meshList.push_back(meshes[meshReferences[r]]);
+                    auto model = Model::Create(std::move(name), std::move(meshList), materials[record.material]);
+                    model->showFaces = record.flags & SHOW_FACES;
+                    model->showTextures = record.flags & SHOW_TEXTURES;
+                    model->showWireframe = record.flags & SHOW_WIREFRAME;
+                    model->isHidden = record.flags & HIDDEN;
+                    model->cullClusters = record.flags & CULL_CLUSTERS;
+                    model->cullBackClusters = record.flags & CULL_BACK_CLUSTERS;
+                    model->wireframeColor = Eigen::Vector4f(record.wireframeColor);
+                    model->meshIndex = record.meshIndex;
+                    node = std::move(model);
+                }
+            } else if (record.type == NodeType::CAMERA) {
+                auto camera = std::make_shared<Camera>(std::move(name), record.camera[0], record.camera[1], record.camera[2], record.camera[3]);
+                camera->length = record.camera[4];
+                camera->SetProjection(camera->ratio);
+                node = std::move(camera);
+            }
+            if (!node) node = Movable::Create(std::move(name), nullptr);
+            node->Tin = FromRecord(record.tin);
+            node->Tout = FromRecord(record.tout);
+            node->isPickable = record.flags & PICKABLE;
+            node->isStatic = record.flags & STATIC;
+            node->lineWidth = record.lineWidth;
+
+            if (ancestors.empty()) {
+                roots.push_back(node);
+            } else {
+                node->parent = ancestors.back().second->weak_from_this();
+                ancestors.back().second->children.push_back(node);
+            }
+            ancestors.emplace_back(GetSubtreeEnd(i), node.get());
+        }
+        return roots;
+    }
+
+private:
+    bool Validate()
+    {
+        if (!mappedFile.IsOpen() || mappedFile.GetSize() < sizeof(FileHeader)) return false;
+        FileHeader header{};
+        std::memcpy(&header, mappedFile.GetData(), sizeof(header));
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != SceneSnapshot::VERSION) return false;
+        for (int t = 0; t < TABLE_COUNT; t++)
+            if (header.offsets[t] > mappedFile.GetSize() || header.counts[t] > (mappedFile.GetSize() - header.offsets[t]) / RECORD_SIZES[t])
+                return false;
+        if (header.counts[NODES] == 0) return false;
+
+        auto copyTable = [this, &header](Table table, auto& records) {
+            records.resize(header.counts[table]);
+            std::memcpy(records.data(), mappedFile.GetData() + header.offsets[table], records.size() * RECORD_SIZES[table]);
+        };
+        copyTable(NODES, nodes);
+        copyTable(MESHES, meshRecords);
+        copyTable(DATA, dataRecords);
+        copyTable(MATERIALS, materialRecords);
+        copyTable(MESH_REFERENCES, meshReferences);
+        strings = {mappedFile.GetData() + header.offsets[STRINGS], header.counts[STRINGS]};
+
+        // the indices between the tables, and the nesting of the sub-trees
+        auto isValidString = [this](const StringRecord& string) { return std::uint64_t(string.offset) + string.length <= strings.size(); };
+        std::vector<int> ends{int(nodes.size())};
+        for (int i = 0; i < int(nodes.size()); i++) {
+            const auto& node = nodes[i];
+            while (ends.back() <= i) ends.pop_back();
+            if (node.subtreeSize == 0 || node.subtreeSize > std::uint64_t(ends.back() - i) || (i == 0 && node.subtreeSize != nodes.size())
+                || !isValidString(node.name) || node.material >= int(materialRecords.size())
+                || std::uint64_t(node.firstMesh) + node.meshCount > meshReferences.size())
+                return false;
+            ends.push_back(i + int(node.subtreeSize));
+        }
+        for (auto mesh: meshReferences)
+            if (mesh >= meshRecords.size()) return false;
+        for (const auto& mesh: meshRecords)
+            if (!isValidString(mesh.name) || std::uint64_t(mesh.firstData) + mesh.dataCount > dataRecords.size()) return false;
+        for (const auto& material: materialRecords)
+            if (!isValidString(material)) return false;
+        return true;
+    }
+
+    [[nodiscard]] std::string_view GetString(const StringRecord& string) const { return strings.substr(string.offset, string.length); }
+
+    template<typename Matrix>
+    bool ReadBlock(std::uint64_t offset, std::uint32_t rows, int cols, Matrix& matrix) const
+    {
+        std::uint64_t bytes = std::uint64_t(rows) * cols * sizeof(typename Matrix::Scalar);
+        if (offset % BLOCK_ALIGNMENT != 0 || offset > mappedFile.GetSize() || bytes > mappedFile.GetSize() - offset) return false;
+        matrix.resize(rows, cols);
+        if (bytes > 0) std::memcpy(matrix.data(), mappedFile.GetData() + offset, bytes);
+        return true;
+    }
+
+    MappedFile mappedFile;
+    bool isValid = false;
+    std::vector<NodeRecord> nodes;
+    std::vector<MeshRecord> meshRecords;
+    std::vector<DataRecord> dataRecords;
+    std::vector<StringRecord> materialRecords;
+    std::vector<std::uint32_t> meshReferences;
+    std::string_view strings;
+};
+
+// attach loaded sub-trees and propagate their transformations (not with SetParent, which searches the children of the parent for each)
+void Attach(const std::vector<std::shared_ptr<Movable>>& roots, const std::shared_ptr<Movable>& parent)
+{
+    for (const auto& root: roots) {
+        if (parent) {
+            root->parent = parent;
+            parent->children.push_back(root);
+        }
+        root->PropagateTransform();
+    }
+}
+
+} // namespace
+
+bool SceneSnapshot::Save(const std::string& file, const std::shared_ptr<Movable>& root)
+{
+    if (!root) return false;
+
+    std::vector<NodeRecord> nodes;
+    std::vector<int> parents;
+    std::vector<MeshRecord> meshes;
+    std::vector<const MeshData*> dataList;
+    std::vector<StringRecord> materials;
+    std::vector<std::uint32_t> meshReferences;
+    std::string strings;
+    std::unordered_map<const Mesh*, std::uint32_t> meshIndices;
+    std::unordered_map<const Material*, std::int32_t> materialIndices;
+    auto addString = [&strings](const std::string& string) {
+        StringRecord record{std::uint32_t(strings.size()), std::uint32_t(string.size())};
+        strings += string;
+        return record;
+    };
+
+    // the nodes in pre-order (with a stack of the nodes to visit, so deep hierarchies don't overflow the call stack)
+    std::vector<std::pair<const Movable*, int>> stack{{root.get(), -1}};
+    while (!stack.empty()) {
+        auto [node, parent] = stack.back();
+        stack.pop_back();
+
+        NodeRecord record{};
+        record.type = NodeType::MOVABLE;
+        record.subtreeSize = 1;
+        record.name = addString(node->name);
+        record.material = -1;
+        record.flags = Flag(node->isPickable, PICKABLE) | Flag(node->isStatic, STATIC);
+        record.lineWidth = node->lineWidth;
+        record.tin = ToRecord(node->Tin);
+        record.tout = ToRecord(node->Tout);
+        if (auto model = dynamic_cast<const Model*>(node)) {
+            record.type = NodeType::MODEL;
+            record.flags |= Flag(model->showFaces, SHOW_FACES) | Flag(model->showTextures, SHOW_TEXTURES) | Flag(model->showWireframe, SHOW_WIREFRAME)
+                            | Flag(model->isHidden, HIDDEN) | Flag(model->cullClusters, CULL_CLUSTERS) | Flag(model->cullBackClusters, CULL_BACK_CLUSTERS);
+            for (int k = 0; k < 4; k++)
+                record.wireframeColor[k] = model->wireframeColor[k];
+            record.meshIndex = model->meshIndex;
+            if (model->material) {
+                auto [it, isNew] = materialIndices.try_emplace(model->material.get(), std::int32_t(materials.size()));
+                if (isNew) materials.push_back(addString(model->material->GetName()));
+                record.material = it->second;
+            }
+            record.firstMesh = std::uint32_t(meshReferences.size());
+            record.meshCount = std::uint32_t(model->GetMeshList().size());
+            for (const auto& mesh: model->GetMeshList()) {
+                auto [it, isNew] = meshIndices.try_emplace(mesh.get(), std::uint32_t(meshes.size()));
+                if (isNew) {
+                    meshes.push_back({addString(mesh->name), std::uint32_t(dataList.size()), std::uint32_t(mesh->data.size())});
+                    for (const auto& data: mesh->data)
+                        dataList.push_back(&data);
+                }
+                meshReferences.push_back(it->second);
+            }
+        } else if (auto camera = dynamic_cast<const Camera*>(node)) {
+            record.type = NodeType::CAMERA;
+            double parameters[5]{camera->fov, camera->ratio, camera->near, camera->far, camera->length};
+            std::copy(parameters, parameters + 5, record.camera);
+        }
+
+        int index = int(nodes.size());
+        nodes.push_back(record);
+        parents.push_back(parent);
+        for (auto child = node->children.rbegin(); child != node->children.rend(); child++)
+            stack.emplace_back(child->get(), index);
+    }
+    for (int i = int(nodes.size()) - 1; i > 0; i--)
+        nodes[parents[i]].subtreeSize += nodes[i].subtreeSize;
+
+    // the tables follow the header, then the blocks of the mesh data
+    FileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    const void* tables[TABLE_COUNT]{nodes.data(), meshes.data(), nullptr, materials.data(), meshReferences.data(), strings.data()};
+    std::vector<DataRecord> dataRecords(dataList.size());
+    tables[DATA] = dataRecords.data();
+    std::uint64_t counts[TABLE_COUNT]{nodes.size(), meshes.size(), dataRecords.size(), materials.size(), meshReferences.size(), strings.size()};
+    std::uint64_t offset = sizeof(FileHeader);
+    for (int t = 0; t < TABLE_COUNT; t++) {
+        offset = Align(offset, TABLE_ALIGNMENT);
+        header.counts[t] = counts[t];
+        header.offsets[t] = offset;
+        offset += counts[t] * RECORD_SIZES[t];
+    }
+    for (std::size_t i = 0; i < dataList.size(); i++) {
+        const auto& data = *dataList[i];
+        auto& record = dataRecords[i];
+        record.vertexCount = std::uint32_t(data.GetVertices().rows());
+        record.faceCount = std::uint32_t(data.GetFaces().rows());
+        record.normalCount = std::uint32_t(data.GetVertexNormals().rows());
+        record.uvCount = std::uint32_t(data.GetTextureCoords().rows());
+        std::uint64_t sizes[4]{std::uint64_t(data.GetVertices().size()) * sizeof(float), std::uint64_t(data.GetFaces().size()) * sizeof(int),
+                               std::uint64_t(data.GetVertexNormals().size()) * sizeof(float), std::uint64_t(data.GetTextureCoords().size()) * sizeof(float)};
+        for (int b = 0; b < 4; b++) {
+            offset = Align(offset, BLOCK_ALIGNMENT);
+            record.offsets[b] = offset;
+            offset += sizes[b];
+        }
+    }
+
+    std::ofstream out(file, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        debug("can't write scene snapshot ", file);
+        return false;
+    }
+    std::uint64_t written = 0;
+    auto write = [&out, &written](const void* data, std::uint64_t offset, std::uint64_t bytes) {
+        static const char padding[BLOCK_ALIGNMENT]{};
+        for (; written < offset; written += std::min<std::uint64_t>(offset - written, BLOCK_ALIGNMENT))
+            out.write(padding, std::streamsize(std::min<std::uint64_t>(offset - written, BLOCK_ALIGNMENT)));
+        out.write(static_cast<const char*>(data), std::streamsize(bytes));
+        written += bytes;
+    };
+    write(&header, 0, sizeof(header));
+    for (int t = 0; t < TABLE_COUNT; t++)
+        write(tables[t], header.offsets[t], counts[t] * RECORD_SIZES[t]);
+    for (std::size_t i = 0; i < dataList.size(); i++) {
+        const auto& data = *dataList[i];
+        const auto& record = dataRecords[i];
+        write(data.GetVertices().data(), record.offsets[0], data.GetVertices().size() * sizeof(float));
+        write(data.GetFaces().data(), record.offsets[1], data.GetFaces().size() * sizeof(int));
+        write(data.GetVertexNormals().data(), record.offsets[2], data.GetVertexNormals().size() * sizeof(float));
+        write(data.GetTextureCoords().data(), record.offsets[3], data.GetTextureCoords().size() * sizeof(float));
+    }
+    return bool(out);
+}
+
+std::shared_ptr<Movable> SceneSnapshot::Load(const std::string& file, const std::shared_ptr<Movable>& parent, const MaterialResolver& materials, const std::string& path)
+{
+    SnapshotFile snapshot(file);
+    int node = snapshot.IsValid() ? snapshot.Find(path) : -1;
+    if (node < 0) {
+        debug("can't load ", path.empty() ? "" : path + " of ", "scene snapshot ", file);
+        return nullptr;
+    }
+
+    auto roots = snapshot.LoadNodes(node, snapshot.GetSubtreeEnd(node), materials);
+    Attach(roots, parent);
+    return roots.empty() ? nullptr : roots[0];
+}
+
+std::vector<std::shared_ptr<Movable>> SceneSnapshot::LoadChildren(const std::string& file, const std::shared_ptr<Movable>& parent, const MaterialResolver& materials,
+                                                                  const std::string& path)
+{
+    SnapshotFile snapshot(file);
+    int node = snapshot.IsValid() ? snapshot.Find(path) : -1;
+    if (node < 0) {
+        debug("can't load ", path.empty() ? "" : path + " of ", "scene snapshot ", file);
+        return {};
+    }
+
+    auto roots = snapshot.LoadNodes(node + 1, snapshot.GetSubtreeEnd(node), materials);
+    Attach(roots, parent);
+    return roots;
+}
+
+} // namespace cg3d
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace cg3d
+{
+
+class Movable;
+class Material;
+
+/**
+    Binary snapshot of a scene graph: the Movable hierarchy with the transformations (Tin and Tout) and the settings of
+    the nodes, the cameras, the models with their materials (by name) and the data of their meshes (stored once per mesh).
+    The nodes are stored in pre-order with the sizes of their sub-trees, so any sub-tree is a contiguous range of the
+    file that can be loaded alone. A snapshot is loaded from a single mapping of the file into pooled nodes, which
+    are linked while they're detached and attached at once (a single propagation of the transformations).
+    Nodes of other types are stored as the closest of Movable, Camera and Model (e.g. an AutoMorphingModel as the model it shows).
+**/
+struct SceneSnapshot
+{
+    static constexpr unsigned int VERSION = 1;
+
+    // the material of a name saved with a snapshot (models without a material are loaded as plain nodes)
+    using MaterialResolver = std::function<std::shared_ptr<Material>(const std::string& name)>;
+
+    static bool Save(const std::string& file, const std::shared_ptr<Movable>& root); // (the root with its sub-tree)
+
+    /**
+        @brief Load a node of a snapshot with its sub-tree
+        @param file      - the snapshot file
+        @param parent    - the node to attach the loaded node to (null to leave it detached)
+        @param materials - gives the materials of the models by their names
+        @param path      - the names of the nodes from the saved root to the node, separated by '/' (empty for the root)
+        @retval          - the loaded node (null if the file can't be read or there's no node at the path)
+    **/
+    static std::shared_ptr<Movable> Load(const std::string& file, const std::shared_ptr<Movable>& parent, const MaterialResolver& materials, const std::string& path = {});
+    // load the children of a node (e.g. the contents of a saved scene into another scene)
+    static std::vector<std::shared_ptr<Movable>> LoadChildren(const std::string& file, const std::shared_ptr<Movable>& parent, const MaterialResolver& materials,
+                                                              const std::string& path = {});
+};
+
+} // namespace cg3d
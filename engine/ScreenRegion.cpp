@@ -0,0 +1,62 @@
+#include "ScreenRegion.h"
+
+#include <utility>
+
+
+namespace cg3d
+{
+
+ScreenRegion ScreenRegion::Rect(const Eigen::Vector2f& corner0, const Eigen::Vector2f& corner1)
+{
+    ScreenRegion region;
+    region.bounds.extend(corner0).extend(corner1);
+    return region;
+}
+
+ScreenRegion ScreenRegion::Lasso(std::vector<Eigen::Vector2f> points)
+{
+    ScreenRegion region;
+    for (const auto& point: points)
+        region.bounds.extend(point);
+    region.polygon = std::move(points);
+    return region;
+}
+
+bool ScreenRegion::Contains(const Eigen::Vector2f& point) const
+{
+    if (!bounds.contains(point)) return false;
+    if (IsRect()) return true;
+
+    // even-odd rule: count the polygon edges crossing a horizontal ray from the point
+    bool inside = false;
+    for (std::size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+        const auto& a = polygon[i];
+        const auto& b = polygon[j];
+        if ((a.y() > point.y()) != (b.y() > point.y()) && point.x() < a.x() + (point.y() - a.y()) * (b.x() - a.x()) / (b.y() - a.y()))
+            inside = !inside;
+    }
+
+    return inside;
+}
+
+bool ScreenRegion::ContainsProjected(const Eigen::Vector4f& clip) const
+{
+    if (clip.w() <= 0 || clip.z() < -clip.w() || clip.z() > clip.w()) return false; // behind the camera or outside the depth range
+    return Contains(clip.head<2>() / clip.w());
+}
+
+Eigen::Matrix4f ScreenRegion::PickMatrix() const
+{
+    Eigen::Vector2f size = bounds.sizes().cwiseMax(1e-6f);
+    Eigen::Vector2f center = bounds.center();
+
+    Eigen::Matrix4f pick = Eigen::Matrix4f::Identity();
+    pick(0, 0) = 2 / size.x();
+    pick(1, 1) = 2 / size.y();
+    pick(0, 3) = -2 * center.x() / size.x();
+    pick(1, 3) = -2 * center.y() / size.y();
+
+    return pick;
+}
+
+} // namespace cg3d
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <vector>
+
+
+namespace cg3d
+{
+
+// a rectangle or a lasso (polygon) on the screen for multi-selection, in the normalized device coordinates of a viewport
+class ScreenRegion
+{
+public:
+    static ScreenRegion Rect(const Eigen::Vector2f& corner0, const Eigen::Vector2f& corner1);
+    static ScreenRegion Lasso(std::vector<Eigen::Vector2f> points);
+
+    [[nodiscard]] inline bool IsRect() const { return polygon.empty(); }
+    [[nodiscard]] inline const Eigen::AlignedBox2f& GetBounds() const { return bounds; }
+    [[nodiscard]] bool Contains(const Eigen::Vector2f& point) const;
+    [[nodiscard]] bool ContainsProjected(const Eigen::Vector4f& clip) const; // a point in clip coordinates (before the division by w)
+
+    // maps the bounds of the region to the whole viewport, so (pick * viewProj) is the frustum of the bounds
+    [[nodiscard]] Eigen::Matrix4f PickMatrix() const;
+
+private:
+    Eigen::AlignedBox2f bounds;
+    std::vector<Eigen::Vector2f> polygon; // empty for rectangles
+};
+
+} // namespace cg3d
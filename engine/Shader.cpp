@@ -26,6 +26,24 @@ void main()
     return SHADER;
 }
 
+std::shared_ptr<const Shader> Shader::GetFixedIdFragmentShader()
+{
+    static auto SHADER = std::make_shared<const Shader>(
+            "Fixed id fragment shader",
+            GL_FRAGMENT_SHADER,
+            R"(
+#version 330
+uniform uint fixedId;
+out uint Id;
+void main()
+{
+    Id = fixedId;
+}
+            )");
+
+    return SHADER;
+}
+
 std::shared_ptr<const Shader> Shader::GetOverlayVertexShader()
 {
     static auto SHADER = std::make_shared<const Shader>(
@@ -114,14 +132,16 @@ out vec3 position0;
 uniform mat4 Proj;
 uniform mat4 View;
 uniform mat4 Model;
+uniform vec3 positionScale; // decoding of compact positions (see MeshGL::vertex_format)
+uniform vec3 positionOffset;
 
 void main()
 {
 	texCoord0 = texcoord;
 	color0 = vec3(Ka);
 	normal0 = (Model  * vec4(normal, 0.0)).xyz;
-	position0 = vec3(Proj * View * Model * vec4(position, 1.0));
-	gl_Position = Proj * View * Model * vec4(position, 1.0); // you must have gl_Position
+	position0 = vec3(Proj * View * Model * vec4(positionOffset + positionScale * position, 1.0));
+	gl_Position = Proj * View * Model * vec4(positionOffset + positionScale * position, 1.0); // you must have gl_Position
 }
     		)");
 
@@ -30,6 +30,7 @@ public:
     Shader(unsigned int type, const std::string& file) : Shader(file, type, ReadFile(file)) {}
 
     static std::shared_ptr<const Shader> GetFixedColorFragmentShader();
+    static std::shared_ptr<const Shader> GetFixedIdFragmentShader(); // writes an unsigned integer id (for integer render targets)
     static std::shared_ptr<const Shader> GetBasicVertexShader();
     static std::shared_ptr<const Shader> GetBasicFragmentShader();
     static std::shared_ptr<const Shader> GetOverlayVertexShader();
@@ -1,6 +1,7 @@
 #include "Texture.h"
 #include "gl.h"
 #include "Debug.h"
+#include <algorithm>
 #include <iostream>
 #include <cassert>
 #include <utility>
@@ -65,6 +66,7 @@ Texture::Texture(const std::string& file, int dim) : name(file), type(DimToType(
     }
     glBindTexture(type, 0);
     stbi_image_free(data);
+    byteSize = std::size_t(width) * std::max(height, 1) * 4 * (dim == 3 ? 6 : 1);
 
     debug("created ", dim == 1 ? "1D" : dim == 3 ? "cube map" : "2D", " texture object ", handle, " of size ", width, "x", height, " pixels");
 }
@@ -92,6 +94,7 @@ Texture::Texture(std::string name, int internalformat, int width, int height, un
         glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     }
     glBindTexture(type, 0);
+    byteSize = std::size_t(width) * std::max(height, 1) * 4;
 
     debug("created ", height > 0 ? "2D" : "1D", " texture object ", handle, " of size ", width, "x", height, " pixels");
 }
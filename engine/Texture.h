@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <string>
 
 
@@ -43,6 +44,8 @@ public:
     **/
     Texture(std::string name, int width, int height, int dim, const void* data);
 
+    [[nodiscard]] inline std::size_t GetByteSize() const { return byteSize; } // of the image data (an estimate of the GPU memory)
+
     void Bind(int slot) const;
     void Unbind(int slot) const;
     ~Texture();
@@ -53,6 +56,7 @@ private:
 
     unsigned int handle = 0;
     unsigned int type = 0;
+    std::size_t byteSize = 0;
     static int DimToType(int dim) ;
 };
 
@@ -0,0 +1,110 @@
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <algorithm>
+
+
+namespace cg3d
+{
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+    if (threadCount == 0)
+        threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+    for (unsigned int i = 0; i < threadCount; i++)
+        threads.emplace_back([this]() { WorkerLoop(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    for (auto& thread: threads)
+        thread.join();
+}
+
+ThreadPool& ThreadPool::Global()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::Enqueue(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.emplace(std::move(task));
+    }
+    condition.notify_one();
+}
+
+void ThreadPool::WorkerLoop()
+{
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) return;
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
+
+void ThreadPool::ParallelFor(int begin, int end, int chunkSize, const std::function<void(int, int)>& func)
+{
+    if (end <= begin) return;
+    chunkSize = std::max(chunkSize, 1);
+    const int chunkCount = (end - begin + chunkSize - 1) / chunkSize;
+
+    if (chunkCount == 1 || threads.empty()) {
+        func(begin, end);
+        return;
+    }
+
+    // the state is shared with the helper tasks, which may only start running after all the chunks are done
+    struct State
+    {
+        std::atomic<int> nextChunk{0};
+        int doneChunks = 0;
+        std::exception_ptr exception;
+        std::mutex mutex;
+        std::condition_variable condition;
+    };
+    auto state = std::make_shared<State>();
+
+    auto runChunks = [state, begin, end, chunkSize, chunkCount, &func]() {
+        for (int chunk; (chunk = state->nextChunk++) < chunkCount;) {
+            try {
+                int chunkBegin = begin + chunk * chunkSize;
+                func(chunkBegin, std::min(chunkBegin + chunkSize, end));
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (!state->exception)
+                    state->exception = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (++state->doneChunks == chunkCount)
+                state->condition.notify_all();
+        }
+    };
+
+    int helperCount = std::min(int(threads.size()), chunkCount - 1);
+    for (int i = 0; i < helperCount; i++)
+        Enqueue(runChunks);
+
+    runChunks();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->condition.wait(lock, [&state, chunkCount]() { return state->doneChunks == chunkCount; });
+    if (state->exception)
+        std::rethrow_exception(state->exception);
+}
+
+} // namespace cg3d
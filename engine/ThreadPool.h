@@ -0,0 +1,64 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+
+namespace cg3d
+{
+
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned int threadCount = 0); // 0 means one thread per core except the calling one
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    void operator=(const ThreadPool&) = delete;
+
+    static ThreadPool& Global(); // shared pool for engine background work
+
+    [[nodiscard]] inline unsigned int GetThreadCount() const { return unsigned(threads.size()); }
+
+    /**
+        @brief Run a task on one of the pool threads
+        @param task - callable object without arguments
+        @retval     - a future holding the result of the task (or the exception it threw)
+    **/
+    template<typename F>
+    auto Submit(F&& task) -> std::future<decltype(task())>
+    {
+        auto packagedTask = std::make_shared<std::packaged_task<decltype(task())()>>(std::forward<F>(task));
+        auto future = packagedTask->get_future();
+        Enqueue([packagedTask]() { (*packagedTask)(); });
+        return future;
+    }
+
+    /**
+        @brief Call func(chunkBegin, chunkEnd) for consecutive chunks of [begin, end) in parallel and wait for all of them
+        (the calling thread takes chunks as well, so it's safe to call this from inside a pool task)
+        @param begin     - first index
+        @param end       - one past the last index
+        @param chunkSize - number of indices per call
+        @param func      - the function to call for each chunk
+    **/
+    void ParallelFor(int begin, int end, int chunkSize, const std::function<void(int, int)>& func);
+
+private:
+    void Enqueue(std::function<void()> task);
+    void WorkerLoop();
+
+    std::vector<std::thread> threads;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
+};
+
+} // namespace cg3d
@@ -0,0 +1,73 @@
+#include "Trs.h"
+
+
+namespace cg3d
+{
+
+Trs Trs::FromMatrix(const Eigen::Matrix4f& matrix)
+{
+    Trs trs;
+    Eigen::Matrix3f linear = matrix.block<3, 3>(0, 0);
+
+    trs.translation = matrix.block<3, 1>(0, 3).cast<double>();
+    trs.scale = linear.colwise().norm().transpose();
+    if (linear.determinant() < 0) // a reflection can't be represented by the rotation, move it into the scale
+        trs.scale.x() = -trs.scale.x();
+
+    for (int i = 0; i < 3; i++)
+        if (trs.scale(i) != 0)
+            linear.col(i) /= trs.scale(i);
+
+    trs.rotation = Eigen::Quaternionf(linear).normalized();
+
+    return trs;
+}
+
+Trs Trs::Interpolate(const Trs& from, const Trs& to, float t)
+{
+    Trs trs;
+    trs.rotation = Eigen::Quaternionf(from.rotation).slerp(t, Eigen::Quaternionf(to.rotation));
+    trs.translation = from.translation + double(t) * (to.translation - from.translation);
+    trs.scale = from.scale + t * (to.scale - from.scale);
+    return trs;
+}
+
+void Trs::ToMatrices(const Trs* trs, Eigen::Matrix4f* matrices, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; i++) {
+        const float x = trs[i].rotation.x(), y = trs[i].rotation.y(), z = trs[i].rotation.z(), w = trs[i].rotation.w();
+        const float sx = trs[i].scale.x(), sy = trs[i].scale.y(), sz = trs[i].scale.z();
+        float* m = matrices[i].data(); // column major
+
+        m[0] = (1 - 2 * (y * y + z * z)) * sx;
+        m[1] = 2 * (x * y + w * z) * sx;
+        m[2] = 2 * (x * z - w * y) * sx;
+        m[3] = 0;
+        m[4] = 2 * (x * y - w * z) * sy;
+        m[5] = (1 - 2 * (x * x + z * z)) * sy;
+        m[6] = 2 * (y * z + w * x) * sy;
+        m[7] = 0;
+        m[8] = 2 * (x * z + w * y) * sz;
+        m[9] = 2 * (y * z - w * x) * sz;
+        m[10] = (1 - 2 * (x * x + y * y)) * sz;
+        m[11] = 0;
+        m[12] = float(trs[i].translation.x());
+        m[13] = float(trs[i].translation.y());
+        m[14] = float(trs[i].translation.z());
+        m[15] = 1;
+    }
+}
+
+Eigen::Matrix4f Trs::Matrix() const
+{
+    Eigen::Matrix4f matrix;
+    ToMatrices(this, &matrix, 1);
+    return matrix;
+}
+
+void Trs::Rotate(const Eigen::Quaternionf& rot)
+{
+    rotation = (Eigen::Quaternionf(rotation) * rot).normalized(); // renormalize so repeated small rotations don't drift
+}
+
+} // namespace cg3d
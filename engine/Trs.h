@@ -0,0 +1,40 @@
+#pragma once
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <cstddef>
+
+
+namespace cg3d
+{
+
+// translation, rotation and scale of a single node, equivalent to the matrix T * R * S (scale, then rotate, then translate)
+// the members are unaligned on purpose (56 bytes instead of the 64 bytes of an Eigen::Affine3f)
+// the translation is kept in double precision so positions far from the origin don't jitter (see Movable::preciseTranslation)
+struct Trs
+{
+    Eigen::Matrix<double, 3, 1, Eigen::DontAlign> translation{0, 0, 0};
+    Eigen::Quaternion<float, Eigen::DontAlign> rotation{1, 0, 0, 0};
+    Eigen::Matrix<float, 3, 1, Eigen::DontAlign> scale{1, 1, 1};
+
+    static Trs Identity() { return {}; }
+    static Trs FromMatrix(const Eigen::Matrix4f& matrix); // decomposes a matrix without shearing
+    static Trs FromAffine(const Eigen::Affine3f& affine) { return FromMatrix(affine.matrix()); }
+    static Trs Interpolate(const Trs& from, const Trs& to, float t); // slerp for the rotation, lerp for the rest
+
+    // bakes count transforms into matrices in a single branch-free pass (the compiler can vectorize the loop body)
+    static void ToMatrices(const Trs* trs, Eigen::Matrix4f* matrices, std::size_t count);
+
+    [[nodiscard]] Eigen::Matrix4f Matrix() const;
+    [[nodiscard]] Eigen::Affine3f Affine() const { return Eigen::Affine3f(Matrix()); }
+    [[nodiscard]] Eigen::Matrix3f RotationMatrix() const { return rotation.toRotationMatrix(); }
+
+    // same semantics as the matching Eigen::Affine3f methods (pretranslate, rotate and scale on the right)
+    void Pretranslate(const Eigen::Vector3f& vec) { translation += vec.cast<double>(); }
+    void Rotate(const Eigen::Quaternionf& rot); // note: exact only while the scale is uniform (true for Tout in Movable)
+    void Rotate(const Eigen::AngleAxisf& rot) { Rotate(Eigen::Quaternionf(rot)); }
+    void Rotate(const Eigen::Matrix3f& rot) { Rotate(Eigen::Quaternionf(rot)); }
+    void Scale(const Eigen::Vector3f& scaleVec) { scale = scale.cwiseProduct(scaleVec); }
+};
+
+} // namespace cg3d
@@ -9,6 +9,7 @@ namespace cg3d
 class Scene;
 class Camera;
 class Visitor;
+class IdBufferVisitor;
 
 class Viewport : public std::enable_shared_from_this<Viewport>
 {
@@ -18,6 +19,7 @@ public:
     std::shared_ptr<Scene> scene;
     std::shared_ptr<Camera> camera;
     std::shared_ptr<Visitor> visitor; // default visitor for drawing
+    std::shared_ptr<IdBufferVisitor> idBufferVisitor; // optional, renders the id buffer after every drawing (for hover picking)
 
     Viewport(int x, int y, int width, int height) : x(x), y(y), width(width), height(height) {}
 
@@ -10,10 +10,33 @@ void Visitor::Run(Camera* camera)
     proj = camera->GetViewProjection();
     view = camera->GetAggregatedTransform().inverse();
     norm = scene->aggregatedTransform;
+    cameraOrigin.setZero();
+
+    if (scene->cameraRelativeRendering) { // move the origin to the camera so the matrices sent to the GPU hold small values only
+        cameraOrigin = camera->preciseTranslation;
+        view.block<3, 1>(0, 3).setZero();
+    }
 
     Init();
 
     scene->Accept(this);
 }
 
+Eigen::Matrix4f Visitor::ModelTransform(const Movable* movable) const
+{
+    if (!scene->cameraRelativeRendering)
+        return movable->isStatic ? movable->aggregatedTransform : norm * movable->aggregatedTransform;
+
+    // compose the model-view translation in double precision on the CPU and only then convert it to float
+    Eigen::Matrix4f transform = movable->aggregatedTransform;
+    Eigen::Vector3d translation = movable->preciseTranslation;
+    if (!movable->isStatic) {
+        transform = norm * transform;
+        translation = norm.block<3, 3>(0, 0).cast<double>() * translation + norm.block<3, 1>(0, 3).cast<double>();
+    }
+    transform.block<3, 1>(0, 3) = (translation - cameraOrigin).cast<float>();
+
+    return transform;
+}
+
 } // namespace cg3d
@@ -22,9 +22,13 @@ public:
     virtual void Visit(Model* model) {};
     virtual void Visit(Movable* movable) {};
 
+    // the model matrix to draw with (relative to the camera position when Scene::cameraRelativeRendering is set)
+    Eigen::Matrix4f ModelTransform(const Movable* movable) const;
+
     Eigen::Matrix4f proj;
     Eigen::Matrix4f view;
     Eigen::Matrix4f norm;
+    Eigen::Vector3d cameraOrigin{Eigen::Vector3d::Zero()}; // the world origin used for drawing (in double precision)
 
 protected:
     Scene* scene;
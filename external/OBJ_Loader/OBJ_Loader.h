@@ -781,17 +781,11 @@ namespace objl
                 }
             }
 
-            // take care of missing normals
-            // these may not be truly acurate but it is the
-            // best they get for not compiling a mesh with normals
+            // missing normals are left zero, so the consumer can tell
+            // them apart and compute smooth normals for the whole mesh
             if (noNormal) {
-                Vector3 A = oVerts[0].Position - oVerts[1].Position;
-                Vector3 B = oVerts[2].Position - oVerts[1].Position;
-
-                Vector3 normal = math::CrossV3(A, B);
-
                 for (int i = 0; i < int(oVerts.size()); i++) {
-                    oVerts[i].Normal = normal;
+                    oVerts[i].Normal = Vector3();
                 }
             }
         }
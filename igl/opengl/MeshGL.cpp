@@ -10,7 +10,129 @@
 #include "bind_vertex_attrib_array.h"
 #include "create_shader_program.h"
 #include "destroy_shader_program.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <vector>
+
+namespace
+{
+  // Like bind_vertex_attrib_array, for packed integer or half float data
+  GLint bind_packed_vertex_attrib_array(
+    const GLuint program_shader,
+    const char * name,
+    GLuint bufferID,
+    const void * data,
+    size_t bytes,
+    GLint components,
+    GLenum type,
+    GLboolean normalized,
+    GLsizei stride,
+    bool refresh)
+  {
+    GLint id = glGetAttribLocation(program_shader, name);
+    if (id < 0)
+      return id;
+    if (bytes == 0)
+    {
+      glDisableVertexAttribArray(id);
+      return id;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, bufferID);
+    if (refresh)
+      glBufferData(GL_ARRAY_BUFFER, bytes, data, GL_DYNAMIC_DRAW);
+    glVertexAttribPointer(id, components, type, normalized, stride, 0);
+    glEnableVertexAttribArray(id);
+    return id;
+  }
+
+  // IEEE 754 half precision (rounded to nearest)
+  uint16_t float_to_half(float value)
+  {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign = (bits >> 16) & 0x8000;
+    const int32_t exponent = int32_t((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+    if (((bits >> 23) & 0xFF) == 0xFF)
+      return uint16_t(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+    if (exponent >= 31)
+      return uint16_t(sign | 0x7C00);
+    if (exponent <= 0)
+    {
+      if (exponent < -10)
+        return uint16_t(sign);
+      mantissa |= 0x800000;
+      const uint32_t shift = 14 - exponent;
+      uint32_t half = mantissa >> shift;
+      if ((mantissa >> (shift - 1)) & 1)
+        half++;
+      return uint16_t(sign | half);
+    }
+    uint32_t half = sign | (uint32_t(exponent) << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000)
+      half++; // (a carry rounds up into the exponent)
+    return uint16_t(half);
+  }
+
+  typedef igl::opengl::MeshGL::RowMatrixXf RowMatrixXf;
+
+  float clamp(float value, float low, float high)
+  {
+    return std::min(std::max(value, low), high);
+  }
+
+  // 16 bit normalized positions relative to the bounds (4 per vertex for alignment)
+  std::vector<uint16_t> pack_positions(
+    const RowMatrixXf & V,
+    Eigen::RowVector3f & offset,
+    Eigen::RowVector3f & scale)
+  {
+    std::vector<uint16_t> packed(V.rows() * 4, 0);
+    if (V.rows() == 0 || V.cols() != 3)
+      return packed;
+    offset = V.colwise().minCoeff();
+    scale = V.colwise().maxCoeff() - offset;
+    for (int i = 0; i < V.rows(); i++)
+      for (int j = 0; j < 3; j++)
+        if (scale(j) > 0)
+          packed[i * 4 + j] = uint16_t(std::lround(
+            clamp((V(i, j) - offset(j)) / scale(j), 0.f, 1.f) * 65535));
+    return packed;
+  }
+
+  // 10:10:10:2 signed normalized normals (the 2 bits are unused)
+  std::vector<uint32_t> pack_normals(const RowMatrixXf & N)
+  {
+    std::vector<uint32_t> packed(N.rows(), 0);
+    for (int i = 0; i < N.rows(); i++)
+      for (int j = 0; j < std::min<int>(3, N.cols()); j++)
+      {
+        const long n = std::lround(clamp(N(i, j), -1.f, 1.f) * 511);
+        packed[i] |= (uint32_t(n) & 0x3FF) << (10 * j);
+      }
+    return packed;
+  }
+
+  std::vector<uint16_t> pack_half(const RowMatrixXf & M)
+  {
+    std::vector<uint16_t> packed(M.size());
+    for (int i = 0; i < M.size(); i++)
+      packed[i] = float_to_half(M.data()[i]);
+    return packed;
+  }
+
+  // 8 bit normalized colors (clamped to [0, 1])
+  std::vector<uint8_t> pack_colors(const RowMatrixXf & C)
+  {
+    std::vector<uint8_t> packed(C.size());
+    for (int i = 0; i < C.size(); i++)
+      packed[i] = uint8_t(std::lround(clamp(C.data()[i], 0.f, 1.f) * 255));
+    return packed;
+  }
+}
 
 IGL_INLINE void igl::opengl::MeshGL::init_buffers()
 {
@@ -73,12 +195,101 @@ IGL_INLINE void igl::opengl::MeshGL::bind_mesh()
 {
   glBindVertexArray(vao_mesh);
   glUseProgram(shader_mesh);
-  bind_vertex_attrib_array(shader_mesh,"position", vbo_V, V_vbo, dirty & MeshGL::DIRTY_POSITION);
-  bind_vertex_attrib_array(shader_mesh,"normal", vbo_V_normals, V_normals_vbo, dirty & MeshGL::DIRTY_NORMAL);
-  bind_vertex_attrib_array(shader_mesh,"Ka", vbo_V_ambient, V_ambient_vbo, dirty & MeshGL::DIRTY_AMBIENT);
-  bind_vertex_attrib_array(shader_mesh,"Kd", vbo_V_diffuse, V_diffuse_vbo, dirty & MeshGL::DIRTY_DIFFUSE);
-  bind_vertex_attrib_array(shader_mesh,"Ks", vbo_V_specular, V_specular_vbo, dirty & MeshGL::DIRTY_SPECULAR);
-  bind_vertex_attrib_array(shader_mesh,"texcoord", vbo_V_uv, V_uv_vbo, dirty & MeshGL::DIRTY_UV);
+
+  // rows changed in place go up as ranges, unless whole buffers go up anyway
+  // (or they are packed, which may depend on all the rows)
+  if (!dirty_rows.empty())
+  {
+    if ((dirty & (MeshGL::DIRTY_POSITION | MeshGL::DIRTY_NORMAL)) ||
+        ((vertex_format | uploaded_format) & (MeshGL::COMPACT_POSITION | MeshGL::COMPACT_NORMAL)))
+      dirty |= MeshGL::DIRTY_POSITION | MeshGL::DIRTY_NORMAL;
+    else
+    {
+      std::sort(dirty_rows.begin(), dirty_rows.end());
+      const auto upload = [](GLuint buffer, const RowMatrixXf & M, int first, int last)
+      {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferSubData(GL_ARRAY_BUFFER, sizeof(float) * first * M.cols(),
+          sizeof(float) * (last - first + 1) * M.cols(), M.data() + first * M.cols());
+      };
+      for (size_t i = 0; i < dirty_rows.size();)
+      {
+        // merge rows that are close into one range
+        size_t j = i;
+        while (j + 1 < dirty_rows.size() && dirty_rows[j + 1] - dirty_rows[j] <= 32)
+          j++;
+        upload(vbo_V, V_vbo, dirty_rows[i], dirty_rows[j]);
+        upload(vbo_V_normals, V_normals_vbo, dirty_rows[i], dirty_rows[j]);
+        i = j + 1;
+      }
+    }
+    dirty_rows.clear();
+  }
+
+  // the format to upload in (compact positions need a shader that decodes them),
+  // a buffer is uploaded again when its data or its format changes
+  uint32_t format = vertex_format;
+  const GLint position_scale_location = glGetUniformLocation(shader_mesh, "positionScale");
+  const GLint position_offset_location = glGetUniformLocation(shader_mesh, "positionOffset");
+  if (position_scale_location < 0 || position_offset_location < 0)
+    format &= ~MeshGL::COMPACT_POSITION;
+  const uint32_t changed_format = format ^ uploaded_format;
+  const auto refresh = [&](uint32_t dirty_flag, uint32_t format_flag)
+  {
+    return (dirty & dirty_flag) || (changed_format & format_flag);
+  };
+
+  if (format & MeshGL::COMPACT_POSITION)
+  {
+    const bool is_dirty = refresh(MeshGL::DIRTY_POSITION, MeshGL::COMPACT_POSITION);
+    const auto packed = is_dirty ? pack_positions(V_vbo, position_offset, position_scale) : std::vector<uint16_t>();
+    bind_packed_vertex_attrib_array(shader_mesh, "position", vbo_V, packed.data(), V_vbo.rows() * 4 * sizeof(uint16_t), 3, GL_UNSIGNED_SHORT, GL_TRUE, 4 * sizeof(uint16_t), is_dirty);
+  }
+  else
+    bind_vertex_attrib_array(shader_mesh,"position", vbo_V, V_vbo, refresh(MeshGL::DIRTY_POSITION, MeshGL::COMPACT_POSITION));
+  if (position_scale_location >= 0 && position_offset_location >= 0)
+  {
+    static const float identity_scale[3] = {1, 1, 1}, identity_offset[3] = {0, 0, 0};
+    const bool compact = format & MeshGL::COMPACT_POSITION;
+    glUniform3fv(position_scale_location, 1, compact ? position_scale.data() : identity_scale);
+    glUniform3fv(position_offset_location, 1, compact ? position_offset.data() : identity_offset);
+  }
+
+  if (format & MeshGL::COMPACT_NORMAL)
+  {
+    const bool is_dirty = refresh(MeshGL::DIRTY_NORMAL, MeshGL::COMPACT_NORMAL);
+    const auto packed = is_dirty ? pack_normals(V_normals_vbo) : std::vector<uint32_t>();
+    bind_packed_vertex_attrib_array(shader_mesh, "normal", vbo_V_normals, packed.data(), V_normals_vbo.rows() * sizeof(uint32_t), 4, GL_INT_2_10_10_10_REV, GL_TRUE, 0, is_dirty);
+  }
+  else
+    bind_vertex_attrib_array(shader_mesh,"normal", vbo_V_normals, V_normals_vbo, refresh(MeshGL::DIRTY_NORMAL, MeshGL::COMPACT_NORMAL));
+
+  const struct { const char * name; GLuint vbo; const RowMatrixXf & M; uint32_t dirty_flag; } colors[] = {
+    {"Ka", vbo_V_ambient, V_ambient_vbo, MeshGL::DIRTY_AMBIENT},
+    {"Kd", vbo_V_diffuse, V_diffuse_vbo, MeshGL::DIRTY_DIFFUSE},
+    {"Ks", vbo_V_specular, V_specular_vbo, MeshGL::DIRTY_SPECULAR}};
+  for (const auto & color : colors)
+  {
+    if (format & MeshGL::COMPACT_COLOR)
+    {
+      const bool is_dirty = refresh(color.dirty_flag, MeshGL::COMPACT_COLOR);
+      const auto packed = is_dirty ? pack_colors(color.M) : std::vector<uint8_t>();
+      bind_packed_vertex_attrib_array(shader_mesh, color.name, color.vbo, packed.data(), color.M.size(), GLint(color.M.cols()), GL_UNSIGNED_BYTE, GL_TRUE, 0, is_dirty);
+    }
+    else
+      bind_vertex_attrib_array(shader_mesh, color.name, color.vbo, color.M, refresh(color.dirty_flag, MeshGL::COMPACT_COLOR));
+  }
+
+  if (format & MeshGL::COMPACT_UV)
+  {
+    const bool is_dirty = refresh(MeshGL::DIRTY_UV, MeshGL::COMPACT_UV);
+    const auto packed = is_dirty ? pack_half(V_uv_vbo) : std::vector<uint16_t>();
+    bind_packed_vertex_attrib_array(shader_mesh, "texcoord", vbo_V_uv, packed.data(), V_uv_vbo.size() * sizeof(uint16_t), GLint(V_uv_vbo.cols()), GL_HALF_FLOAT, GL_FALSE, 0, is_dirty);
+  }
+  else
+    bind_vertex_attrib_array(shader_mesh,"texcoord", vbo_V_uv, V_uv_vbo, refresh(MeshGL::DIRTY_UV, MeshGL::COMPACT_UV));
+
+  uploaded_format = format;
 
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo_F);
   if (dirty & MeshGL::DIRTY_FACE)
@@ -147,6 +358,25 @@ IGL_INLINE void igl::opengl::MeshGL::draw_mesh(bool solid)
   glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 }
 
+IGL_INLINE void igl::opengl::MeshGL::draw_mesh_ranges(bool solid, const int * counts, const void * const * offsets, int range_count)
+{
+  if (range_count == 0)
+    return;
+
+  glPolygonMode(GL_FRONT_AND_BACK, solid ? GL_FILL : GL_LINE);
+
+  /* Avoid Z-buffer fighting between filled triangles & wireframe lines */
+  if (solid)
+  {
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(1.0, 1.0);
+  }
+  glMultiDrawElements(GL_TRIANGLES, counts, GL_UNSIGNED_INT, offsets, range_count);
+
+  glDisable(GL_POLYGON_OFFSET_FILL);
+  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+}
+
 IGL_INLINE void igl::opengl::MeshGL::draw_overlay_lines()
 {
   glDrawElements(GL_LINES, lines_F_vbo.rows(), GL_UNSIGNED_INT, 0);
@@ -14,6 +14,7 @@
 
 #include <igl/igl_inline.h>
 #include <Eigen/Core>
+#include <vector>
 
 namespace igl
 {
@@ -42,6 +43,22 @@ public:
     DIRTY_ALL            = 0x03FF
   };
 
+  // Compact vertex formats (combine the flags, see vertex_format):
+  // positions as 16 bit normalized integers relative to the bounds of the
+  // mesh (decoded in the vertex shader by the uniforms positionScale and
+  // positionOffset, shaders without them get float positions), normals as
+  // 10:10:10:2 signed normalized integers, UVs as half floats and the
+  // ambient, diffuse and specular colors as 8 bit normalized integers
+  enum VertexFormat
+  {
+    FORMAT_FLOAT       = 0x0000,
+    COMPACT_POSITION   = 0x0001,
+    COMPACT_NORMAL     = 0x0002,
+    COMPACT_UV         = 0x0004,
+    COMPACT_COLOR      = 0x0008,
+    FORMAT_COMPACT     = 0x000F
+  };
+
   bool is_initialized = false;
   GLuint vao_mesh;
   GLuint vao_overlay_lines;
@@ -91,6 +108,17 @@ public:
   // Marks dirty buffers that need to be uploaded to OpenGL
   uint32_t dirty;
 
+  // The format of the vertex buffers (changes are uploaded on the next bind)
+  uint32_t vertex_format = FORMAT_FLOAT;
+  // The format the buffers were last uploaded in
+  uint32_t uploaded_format = FORMAT_FLOAT;
+  // Rows of V_vbo and V_normals_vbo changed in place since the last bind
+  // (uploaded as ranges with glBufferSubData instead of whole buffers)
+  std::vector<int> dirty_rows;
+  // Decoding of the compact positions (position = offset + scale * packed)
+  Eigen::RowVector3f position_offset = Eigen::RowVector3f::Zero();
+  Eigen::RowVector3f position_scale = Eigen::RowVector3f::Ones();
+
   // Initialize shaders and buffers
   IGL_INLINE void init();
 
@@ -106,6 +134,10 @@ public:
   /// Draw the currently buffered mesh (either solid or wireframe)
   IGL_INLINE void draw_mesh(bool solid);
 
+  /// Draw ranges of the currently buffered faces with a single call
+  /// (counts of indices and byte offsets into the index buffer)
+  IGL_INLINE void draw_mesh_ranges(bool solid, const int * counts, const void * const * offsets, int range_count);
+
   // Bind the underlying OpenGL buffer objects for subsequent line overlay draw calls
   IGL_INLINE void bind_overlay_lines();
 
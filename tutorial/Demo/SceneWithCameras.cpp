@@ -3,6 +3,7 @@
 #include <utility>
 
 #include "ObjLoader.h"
+#include "AssetManager.h"
 #include "AutoMorphingModel.h"
 #include "SceneWithImGui.h"
 #include "CamModel.h"
@@ -39,7 +40,7 @@ void SceneWithCameras::BuildImGui()
     }
     ImGui::SameLine();
     if (ImGui::Button("Center"))
-        camera->SetTout(Eigen::Affine3f::Identity());
+        camera->SetTout(Trs::Identity());
     if (pickedModel) {
         ImGui::Text("Picked model: %s", pickedModel->name.c_str());
         ImGui::SameLine();
@@ -78,8 +79,8 @@ void SceneWithCameras::BuildImGui()
             if (ImGui::Button("Dump model transformations")) {
                 Eigen::IOFormat format(2, 0, ", ", "\n", "[", "]");
                 const Eigen::Matrix4f& transform = pickedModel->GetAggregatedTransform();
-                std::cout << "Tin:" << std::endl << pickedModel->Tin.matrix().format(format) << std::endl
-                          << "Tout:" << std::endl << pickedModel->Tout.matrix().format(format) << std::endl
+                std::cout << "Tin:" << std::endl << pickedModel->Tin.Matrix().format(format) << std::endl
+                          << "Tout:" << std::endl << pickedModel->Tout.Matrix().format(format) << std::endl
                           << "Transform:" << std::endl << transform.matrix().format(format) << std::endl
                           << "--- Transform Breakdown ---" << std::endl
                           << "Rotation:" << std::endl << Movable::GetTranslation(transform).matrix().format(format) << std::endl
@@ -95,10 +96,10 @@ void SceneWithCameras::BuildImGui()
 
 void SceneWithCameras::DumpMeshData(const Eigen::IOFormat& simple, const MeshData& data)
 {
-    std::cout << "vertices mesh: " << data.vertices.format(simple) << std::endl;
-    std::cout << "faces mesh: " << data.faces.format(simple) << std::endl;
-    std::cout << "vertex normals mesh: " << data.vertexNormals.format(simple) << std::endl;
-    std::cout << "texture coordinates mesh: " << data.textureCoords.format(simple) << std::endl;
+    std::cout << "vertices mesh: " << data.GetVertices().format(simple) << std::endl;
+    std::cout << "faces mesh: " << data.GetFaces().format(simple) << std::endl;
+    std::cout << "vertex normals mesh: " << data.GetVertexNormals().format(simple) << std::endl;
+    std::cout << "texture coordinates mesh: " << data.GetTextureCoords().format(simple) << std::endl;
 }
 
 SceneWithCameras::SceneWithCameras(std::string name, Display* display) : SceneWithImGui(std::move(name), display)
@@ -119,7 +120,7 @@ void SceneWithCameras::Init(float fov, int width, int height, float near, float
 {
     // create the basic elements of the scene
     SetNamedObject(root, Movable::Create, shared_from_this()); // the parent of all the shapes
-    auto program = std::make_shared<Program>("shaders/basicShader"); // TODO: TAL: replace with hard-coded basic program
+    auto program = AssetManager::Global().GetProgram("shaders/basicShader"); // TODO: TAL: replace with hard-coded basic program
     SetNamedObject(carbon, std::make_shared<Material>, program); // default material
     carbon->AddTexture(0, "textures/carbon.jpg", 2);
 
@@ -128,7 +129,7 @@ void SceneWithCameras::Init(float fov, int width, int height, float near, float
     camList[0] = std::make_shared<Camera>("camera0", fov, float(width) / float(height), near, far);
     for (int i = 1; i < camList.size(); i++) {
         auto camera = Camera("", fov, double(width) / height, near, far);
-        auto model = ObjLoader::ModelFromObj(std::string("camera") + std::to_string(i), "data/camera.obj", carbon);
+        auto model = AssetManager::Global().CreateModel(std::string("camera") + std::to_string(i), "data/camera.obj", carbon);
         camList[i] = std::make_shared<CamModel>(camera, *model);
         camList[i]->SetParent(root);
     }
@@ -173,7 +174,7 @@ void SceneWithCameras::Init(float fov, int width, int height, float near, float
     autoSnake->SetParent(root);
 
     SetNamedObject(cylinder, Model::Create, Mesh::Cylinder(), grass, root);
-    NewNamedObject(sphereMesh, ObjLoader::MeshFromObjFiles, "data/sphere.obj");
+    auto sphereMesh = AssetManager::Global().GetMesh("data/sphere.obj");
     SetNamedObject(sphere1, Model::Create, sphereMesh, grass, cylinder);
     SetNamedObject(sphere2, Model::Create, sphereMesh, grass, cylinder);
     sphere1->Translate(-1.3, Axis::X);
@@ -194,7 +195,7 @@ std::shared_ptr<CamModel> SceneWithCameras::CreateCameraWithModel(int width, int
 {
     static CamModel prototype([width, height, fov, near, far, material]() -> CamModel {
         auto camera = Camera("", fov, double(width) / height, near, far);
-        auto model = ObjLoader::ModelFromObj("camera", "data/camera.obj", material);
+        auto model = AssetManager::Global().CreateModel("camera", "data/camera.obj", material);
         return {camera, *model};
     }());
 
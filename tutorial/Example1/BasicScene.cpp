@@ -22,7 +22,7 @@ void BasicScene::Init(float fov, int width, int height, float near, float far)
     camera->Translate(15, Axis::Z);
     cube->Scale(3);
     auto mesh = cube->GetMeshList();
-    std::cout<< "vertices: \n" << mesh[0]->data[0].vertices<<std::endl;
+    std::cout<< "vertices: \n" << mesh[0]->data[0].GetVertices()<<std::endl;
 }
 
 void BasicScene::Update(const Program& program, const Eigen::Matrix4f& proj, const Eigen::Matrix4f& view, const Eigen::Matrix4f& model)
@@ -3,6 +3,8 @@
   uniform mat4 Proj;
   uniform mat4 View;
   uniform mat4 Model;
+  uniform vec3 positionScale; // decoding of compact positions (see MeshGL::vertex_format)
+  uniform vec3 positionOffset;
   in vec3 position;
   in vec3 normal;
   in vec3 color;
@@ -17,7 +19,7 @@
 
   void main()
   {
-    position_eye = vec3 (View * Model * vec4 (position, 1.0));
+    position_eye = vec3 (View * Model * vec4 (positionOffset + positionScale * position, 1.0));
     normal_eye = vec3 (Model * vec4 (normal, 0.0));
     normal_eye = normalize(normal_eye);
     Kai = vec4(color,1);
@@ -12,11 +12,13 @@ in vec2 texCoords;
 uniform mat4 Proj;
 uniform mat4 View;
 uniform mat4 Model;
+uniform vec3 positionScale; // decoding of compact positions (see MeshGL::vertex_format)
+uniform vec3 positionOffset;
 
 //out vec3 color0;
 
 void main()
 {
 	//color0 = color;
-	gl_Position = Proj *View * Model* vec4(position, 1.0);
+	gl_Position = Proj *View * Model* vec4(positionOffset + positionScale * position, 1.0);
 }
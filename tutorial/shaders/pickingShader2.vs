@@ -12,10 +12,12 @@ out vec3 normal0;
 uniform mat4 Proj;
 uniform mat4 View;
 uniform mat4 Model;
+uniform vec3 positionScale; // decoding of compact positions (see MeshGL::vertex_format)
+uniform vec3 positionOffset;
 
 
 void main()
 {
 	normal0 = vec3(Model* vec4(normal, 0.0));
-	gl_Position = Proj *View * Model* vec4(position, 1.0);
+	gl_Position = Proj *View * Model* vec4(positionOffset + positionScale * position, 1.0);
 }